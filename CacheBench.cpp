@@ -0,0 +1,355 @@
+// Microbenchmarks for the cache engine, built as the "bench" target.
+//
+//   ./bench                 run everything
+//   ./bench lru             only benchmarks whose name contains "lru"
+//   ./bench --min-time 2    run each one for at least 2 seconds
+//   ./bench --help          print this usage
+//
+// Every benchmark reports nanoseconds per operation and millions of
+// operations per second, so runs can be compared across commits.
+
+#include "CacheEngine.h"
+#include "ConflictProfiler.h"
+#include "TimingModel.h"
+#include "Trace.h"
+#include "TraceContainer.h"
+#include "WorkloadGenerator.h"
+
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace {
+
+double minSeconds = 0.5;
+const char *filter = nullptr;
+
+// Anything the optimiser must not throw away ends up here
+volatile int64_t sink;
+
+const char USAGE[] =
+    "usage: bench [--min-time SECONDS] [FILTER]\n"
+    "\n"
+    "  bench                 run everything\n"
+    "  bench lru             only benchmarks whose name contains \"lru\"\n"
+    "  bench --min-time 2    run each one for at least 2 seconds\n"
+    "  bench --help          print this usage\n";
+
+// Whether the name filter lets this benchmark run, so setup can be skipped too
+bool selected(const char *name)
+{
+    return !filter || std::strstr(name, filter);
+}
+
+// Runs body(n) with a growing n until it takes at least minSeconds.
+// body returns the number of operations it did.
+void runBenchmark(const char *name, const std::function<int64_t(int64_t)> &body)
+{
+    if (!selected(name))
+        return;
+
+    int64_t iterations = 1 << 12;
+    for (;;) {
+        auto start = std::chrono::steady_clock::now();
+        int64_t ops = body(iterations);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (seconds >= minSeconds || iterations >= (int64_t(1) << 40)) {
+            std::printf("%-40s %10.2f ns/op %10.2f Mops/s\n",
+                        name, seconds * 1e9 / ops, ops / seconds / 1e6);
+            return;
+        }
+        // Aim a bit past the target so the next round is usually the last
+        double scale = seconds > 0 ? 1.4 * minSeconds / seconds : 100.0;
+        iterations = int64_t(iterations * (scale < 100.0 ? (scale > 2.0 ? scale : 2.0) : 100.0));
+    }
+}
+
+// "Random (uniform)" -> "random_uniform"
+std::string slug(const char *text)
+{
+    std::string out;
+    for (; *text; ++text) {
+        if (std::isalnum(static_cast<unsigned char>(*text)))
+            out += char(std::tolower(static_cast<unsigned char>(*text)));
+        else if (*text == ' ')
+            out += '_';
+    }
+    return out;
+}
+
+std::vector<int64_t> makeAddresses(WorkloadGenerator::Pattern pattern, int64_t rangeBytes, size_t count)
+{
+    WorkloadGenerator generator(42);
+    WorkloadGenerator::Config config;
+    config.pattern = pattern;
+    config.size = rangeBytes;
+    config.elementSize = 8;
+    config.stride = 4096;
+    config.matrixDim = 1024;
+    config.tileDim = 32;
+    generator.add(config);
+
+    std::vector<int64_t> addresses(count);
+    generator.generate(addresses.data(), count);
+    return addresses;
+}
+
+// Loops over a fixed buffer so the generator cost isn't measured
+int64_t replay(CacheEngine &engine, const std::vector<int64_t> &addresses, int64_t iterations)
+{
+    size_t n = addresses.size();
+    size_t pos = 0;
+    for (int64_t i = 0; i < iterations; ++i) {
+        engine.access(addresses[pos]);
+        if (++pos == n)
+            pos = 0;
+    }
+    sink = engine.stats().misses;
+    return iterations;
+}
+
+void benchAddressDecomposition()
+{
+    CacheEngine engine;
+    engine.configure(32 * 1024, 64, 8, CacheEngine::LRU);
+    std::vector<int64_t> addresses = makeAddresses(WorkloadGenerator::Uniform, 1 << 26, 1 << 16);
+
+    runBenchmark("address_decomposition", [&](int64_t iterations) {
+        int64_t sum = 0;
+        size_t n = addresses.size();
+        for (int64_t i = 0; i < iterations; ++i) {
+            int64_t block = engine.blockOf(addresses[size_t(i) & (n - 1)]);
+            sum += engine.setIndexOf(block) + engine.tagOf(block);
+        }
+        sink = sum;
+        return iterations;
+    });
+}
+
+void benchSetProbe(int indexFunction, const char *name)
+{
+    // Working set fits, so after warm-up every access is a hit
+    CacheEngine engine;
+    engine.setIndexFunction(indexFunction);
+    engine.configure(32 * 1024, 64, 8, CacheEngine::LRU);
+    std::vector<int64_t> addresses = makeAddresses(WorkloadGenerator::Uniform, 16 * 1024, 1 << 16);
+    engine.run(addresses.data(), addresses.size());
+
+    runBenchmark(name, [&](int64_t iterations) {
+        return replay(engine, addresses, iterations);
+    });
+}
+
+void benchReplacement(int policy, const char *name)
+{
+    // Working set 8x the cache: nearly every access evicts
+    CacheEngine engine;
+    engine.configure(32 * 1024, 64, 8, policy);
+    engine.loadHexMemory("00");
+    std::vector<int64_t> addresses = makeAddresses(WorkloadGenerator::Uniform, 256 * 1024, 1 << 16);
+
+    runBenchmark(name, [&](int64_t iterations) {
+        return replay(engine, addresses, iterations);
+    });
+}
+
+void benchFill(int blockSize, const char *name)
+{
+    // Streaming through the mock RAM: every access is a miss with a full block copy
+    static const char HEX_RAM[] = "0123456789abcdef";
+    std::string hex;
+    for (int i = 0; i < 2 * 64 * 1024; ++i)
+        hex += HEX_RAM[i % 16];
+
+    CacheEngine engine;
+    engine.configure(4 * 1024, blockSize, 1, CacheEngine::LRU);
+    engine.loadHexMemory(hex.c_str());
+    std::vector<int64_t> addresses;
+    for (int64_t a = 0; a < 64 * 1024; a += blockSize)
+        addresses.push_back(a);
+
+    runBenchmark(name, [&](int64_t iterations) {
+        return replay(engine, addresses, iterations);
+    });
+}
+
+void benchTextDecode()
+{
+    WorkloadGenerator generator(7);
+    WorkloadGenerator::Config config;
+    config.pattern = WorkloadGenerator::Uniform;
+    config.size = int64_t(1) << 32;
+    generator.add(config);
+    std::string text = generator.generateText(1 << 16);
+
+    runBenchmark("trace_decode_text", [&](int64_t iterations) {
+        std::vector<int64_t> out;
+        out.reserve(1 << 16);
+        int64_t done = 0;
+        while (done < iterations) {
+            out.clear();
+            decodeTextTrace(text.data(), text.size(), out);
+            done += int64_t(out.size());
+        }
+        sink = out.back();
+        return done;
+    });
+}
+
+// Compressed container in the working directory, read back on all cores
+void benchCompressedDecode()
+{
+    // Writing 4M addresses is slow and leaves a file behind, so skip it unless wanted
+    std::string name = std::string("trace_decode_compressed_") + traceCodecName(defaultTraceCodec());
+    if (!selected(name.c_str()))
+        return;
+
+    std::vector<int64_t> addresses = makeAddresses(WorkloadGenerator::MatrixTile, 64 * 1024 * 1024, 1 << 22);
+    const char *path = "bench_trace.ctz";
+    TraceContainerWriter writer;
+    if (!writer.open(path) || !writer.write(addresses.data(), addresses.size()) || !writer.close()) {
+        std::fprintf(stderr, "bench: cannot write %s, skipping trace_decode_compressed\n", path);
+        return;
+    }
+    runBenchmark(name.c_str(), [&](int64_t iterations) {
+        std::vector<int64_t> out(1 << 16);
+        int64_t done = 0;
+        while (done < iterations) {
+            TraceContainerReader reader;
+            reader.open(path);
+            for (size_t n; (n = reader.read(out.data(), out.size())) > 0;)
+                done += int64_t(n);
+        }
+        sink = out[0];
+        return done;
+    });
+    std::remove(path);
+}
+
+void benchEndToEnd()
+{
+    struct Setup {
+        const char *name;
+        int cacheSize;
+        int associativity;
+    };
+    const Setup setups[] = {
+        { "l1_32k_8way", 32 * 1024, 8 },
+        { "l2_1m_16way", 1024 * 1024, 16 },
+    };
+
+    for (const Setup &setup : setups) {
+        for (int p = WorkloadGenerator::Sequential; p <= WorkloadGenerator::MatrixTile; ++p) {
+            WorkloadGenerator::Pattern pattern = WorkloadGenerator::Pattern(p);
+            std::string name = std::string("e2e_") + setup.name + "_" + slug(WorkloadGenerator::patternName(pattern));
+
+            CacheEngine engine;
+            engine.configure(setup.cacheSize, 64, setup.associativity, CacheEngine::LRU);
+            std::vector<int64_t> addresses = makeAddresses(pattern, 8 * 1024 * 1024, 1 << 20);
+
+            runBenchmark(name.c_str(), [&](int64_t iterations) {
+                return replay(engine, addresses, iterations);
+            });
+        }
+    }
+}
+
+// Engine plus timing model, the way cachesim-cli --timing drives them
+void benchTiming()
+{
+    const WorkloadGenerator::Pattern patterns[] = {
+        WorkloadGenerator::Sequential,
+        WorkloadGenerator::Uniform,
+    };
+    for (WorkloadGenerator::Pattern pattern : patterns) {
+        std::string name = std::string("timing_l1_32k_8way_") + slug(WorkloadGenerator::patternName(pattern));
+
+        CacheEngine engine;
+        engine.configure(32 * 1024, 64, 8, CacheEngine::LRU);
+        TimingModel timing;
+        timing.reset(engine);
+        std::vector<int64_t> addresses = makeAddresses(pattern, 8 * 1024 * 1024, 1 << 20);
+
+        runBenchmark(name.c_str(), [&](int64_t iterations) {
+            size_t pos = 0;
+            for (int64_t i = 0; i < iterations; ++i) {
+                timing.record(engine.access(addresses[pos]));
+                if (++pos == addresses.size())
+                    pos = 0;
+            }
+            sink = timing.stats().cycles;
+            return iterations;
+        });
+    }
+}
+
+// Engine plus conflict profiler on a stream where nearly every access
+// misses, the way cachesim-cli drives them; sampleEvery 0 leaves the
+// profiler out for the baseline
+void benchProfiler(int sampleEvery, const char *name)
+{
+    if (!selected(name))
+        return;
+
+    CacheEngine engine;
+    engine.configure(32 * 1024, 64, 8, CacheEngine::LRU);
+    ConflictProfiler profiler(engine, 16, 4096, sampleEvery);
+    std::vector<int64_t> addresses = makeAddresses(WorkloadGenerator::Uniform, 256 * 1024 * 1024, 1 << 20);
+
+    runBenchmark(name, [&](int64_t iterations) {
+        size_t pos = 0;
+        for (int64_t i = 0; i < iterations; ++i) {
+            CacheEngine::AccessResult r = engine.access(addresses[pos]);
+            if (sampleEvery)
+                profiler.record(r);
+            if (++pos == addresses.size())
+                pos = 0;
+        }
+        sink = engine.stats().misses;
+        return iterations;
+    });
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--help") == 0 || std::strcmp(argv[i], "-h") == 0) {
+            std::fputs(USAGE, stdout);
+            return 0;
+        } else if (std::strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            minSeconds = std::atof(argv[++i]);
+        } else if (argv[i][0] == '-' || filter) {
+            // A mistyped option would otherwise filter out every benchmark
+            std::fprintf(stderr, "bench: unexpected argument %s\n%s", argv[i], USAGE);
+            return 1;
+        } else {
+            filter = argv[i];
+        }
+    }
+
+    benchAddressDecomposition();
+    benchSetProbe(CacheEngine::Modulo, "set_probe_hit_8way");
+    benchSetProbe(CacheEngine::XorFold, "set_probe_hit_8way_xor");
+    benchSetProbe(CacheEngine::PrimeModulo, "set_probe_hit_8way_prime");
+    benchSetProbe(CacheEngine::Skewed, "set_probe_hit_8way_skewed");
+    benchReplacement(CacheEngine::LRU, "replacement_lru_8way");
+    benchReplacement(CacheEngine::FIFO, "replacement_fifo_8way");
+    benchFill(16, "fill_copy_16B");
+    benchFill(64, "fill_copy_64B");
+    benchTextDecode();
+    benchCompressedDecode();
+    benchEndToEnd();
+    benchTiming();
+    benchProfiler(0, "profiler_off_uniform_8way");
+    benchProfiler(16, "profiler_sampled_uniform_8way");
+    benchProfiler(1, "profiler_full_uniform_8way");
+    return 0;
+}
@@ -0,0 +1,137 @@
+// cachesim-capture: runs a program built with CacheTrace.h with tracing
+// switched on and reports what it captured.
+//
+//   cachesim-capture -o run.ctr ./my_service --port 8080
+//   cachesim-cli run.ctr
+//
+// The program itself writes the trace; this only sets CACHESIM_TRACE,
+// waits for it and reads the result back.
+
+#include "Trace.h"
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+void printUsage(FILE *out)
+{
+    std::fprintf(out,
+        "usage: cachesim-capture [-o FILE] program [args...]\n"
+        "\n"
+        "Runs program with CACHESIM_TRACE=FILE so the reads it marks with\n"
+        "CACHESIM_TRACE_READ (CacheTrace.h) are written to FILE, a packed\n"
+        "trace cachesim-cli reads directly.\n"
+        "\n"
+        "  -o FILE   trace file (default: PROGRAM.ctr in the current directory)\n"
+        "  --help\n");
+}
+
+std::string baseName(const std::string &path)
+{
+    size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    std::string output;
+    int first = 1;
+    while (first < argc && argv[first][0] == '-') {
+        std::string arg = argv[first];
+        if (arg == "--help" || arg == "-h") {
+            printUsage(stdout);
+            return 0;
+        } else if (arg == "-o" && first + 1 < argc) {
+            output = argv[first + 1];
+            first += 2;
+        } else if (arg == "--") {
+            ++first;
+            break;
+        } else {
+            std::fprintf(stderr, "cachesim-capture: unknown option %s\n", arg.c_str());
+            printUsage(stderr);
+            return 1;
+        }
+    }
+    if (first >= argc) {
+        printUsage(stderr);
+        return 1;
+    }
+    if (output.empty())
+        output = baseName(argv[first]) + ".ctr";
+
+    // A stale file from an earlier run would look like a capture
+    std::remove(output.c_str());
+
+    pid_t child = fork();
+    if (child < 0) {
+        std::fprintf(stderr, "cachesim-capture: fork failed: %s\n", std::strerror(errno));
+        return 1;
+    }
+    if (child == 0) {
+        setenv("CACHESIM_TRACE", output.c_str(), 1);
+        execvp(argv[first], argv + first);
+        std::fprintf(stderr, "cachesim-capture: cannot run %s: %s\n", argv[first], std::strerror(errno));
+        _exit(127);
+    }
+
+    int status = 0;
+    while (waitpid(child, &status, 0) < 0) {
+        if (errno != EINTR) {
+            std::fprintf(stderr, "cachesim-capture: waitpid failed: %s\n", std::strerror(errno));
+            return 1;
+        }
+    }
+    int exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    if (WIFSIGNALED(status))
+        std::fprintf(stderr, "cachesim-capture: %s was killed by signal %d; the end of the trace may be missing\n",
+                     argv[first], WTERMSIG(status));
+    if (exitCode == 127)
+        return exitCode;
+
+    struct stat info;
+    if (stat(output.c_str(), &info) != 0) {
+        std::fprintf(stderr, "cachesim-capture: %s wrote no trace (was it built with CacheTrace.h?)\n", argv[first]);
+        return exitCode ? exitCode : 1;
+    }
+
+    // Read it back: checks the file and gives the numbers worth knowing
+    TraceReader reader;
+    std::string error;
+    if (!reader.open(output, TraceReader::Packed, &error)) {
+        std::fprintf(stderr, "cachesim-capture: %s\n", error.c_str());
+        return 1;
+    }
+    std::vector<int64_t> chunk(1 << 16);
+    int64_t accesses = 0;
+    int64_t lowest = INT64_MAX;
+    int64_t highest = INT64_MIN;
+    for (size_t n; (n = reader.read(chunk.data(), chunk.size())) > 0;) {
+        accesses += int64_t(n);
+        for (size_t i = 0; i < n; ++i) {
+            lowest = chunk[i] < lowest ? chunk[i] : lowest;
+            highest = chunk[i] > highest ? chunk[i] : highest;
+        }
+    }
+    if (reader.failed())
+        std::fprintf(stderr, "cachesim-capture: %s\n", reader.errorMessage().c_str());
+
+    std::printf("%s: %lld accesses, %lld bytes (%.2f bytes per access, %.1fx smaller than .bin)\n",
+                output.c_str(), (long long)accesses, (long long)info.st_size,
+                accesses ? double(info.st_size) / double(accesses) : 0.0,
+                info.st_size ? 8.0 * double(accesses) / double(info.st_size) : 0.0);
+    if (accesses)
+        std::printf("addresses 0x%llx to 0x%llx\n", (long long)lowest, (long long)highest);
+    return exitCode;
+}
@@ -0,0 +1,797 @@
+#include "CacheEngine.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char CHECKPOINT_MAGIC[8] = { 'C', 'S', 'I', 'M', 'C', 'K', 'P', 'T' };
+const uint32_t CHECKPOINT_VERSION = 4;   // 2: hit/miss/eviction totals, 3: index function, 4: extensions
+const uint32_t CHECKPOINT_V2_HEADER_SIZE = 88;
+const uint32_t CHECKPOINT_V3_HEADER_SIZE = 96;
+
+// On-disk header, followed by the line array and then the data array, then
+// (version 4, only when in use) the valid masks, the data slots and their
+// CLOCK bits, the victim lines and the victim data. Fields are stored in native byte order; the
+// layout has no padding.
+struct CheckpointHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    int32_t cacheSize;
+    int32_t blockSize;
+    int32_t associativity;
+    int32_t policy;
+    int32_t numSets;
+    int32_t numWays;
+    int64_t accessCounter;
+    int64_t hits;
+    int64_t misses;
+    int64_t evictions;
+    uint64_t lineCount;
+    uint64_t dataBytes;
+    int32_t indexFunction;   // version 3 on; version 2 files are Modulo
+    int32_t reserved;
+    int32_t victimEntries;   // version 4 on; older files have no extensions
+    int32_t sectors;
+    int32_t tagRatio;
+    int32_t reserved2;
+    int64_t victimHits;
+    int64_t sectorMisses;
+    int64_t fills;
+    int64_t bytesFetched;
+    int64_t clockHand;
+};
+
+void setError(std::string *error, const std::string &message)
+{
+    if (error)
+        *error = message;
+}
+
+// Read-only view of a whole file: mmap where we have it, a plain read otherwise
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string &path)
+    {
+#ifndef _WIN32
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+            void *p = ::mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                m_data = static_cast<const uint8_t *>(p);
+                m_size = size_t(st.st_size);
+            }
+        }
+        ::close(fd);
+#else
+        FILE *f = std::fopen(path.c_str(), "rb");
+        if (!f)
+            return;
+        std::fseek(f, 0, SEEK_END);
+        long size = std::ftell(f);
+        std::fseek(f, 0, SEEK_SET);
+        if (size > 0) {
+            m_buffer.resize(size_t(size));
+            if (std::fread(m_buffer.data(), 1, m_buffer.size(), f) == m_buffer.size()) {
+                m_data = m_buffer.data();
+                m_size = m_buffer.size();
+            }
+        }
+        std::fclose(f);
+#endif
+    }
+
+    ~MappedFile()
+    {
+#ifndef _WIN32
+        if (m_data)
+            ::munmap(const_cast<uint8_t *>(m_data), m_size);
+#endif
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const uint8_t *data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    const uint8_t *m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    std::vector<uint8_t> m_buffer;
+#endif
+};
+
+// log2(value), or -1 when value isn't a power of two
+int exactLog2(int value)
+{
+    if (value <= 0 || (value & (value - 1)) != 0)
+        return -1;
+    int bits = 0;
+    while ((1 << bits) < value)
+        ++bits;
+    return bits;
+}
+
+int largestPrimeUpTo(int n)
+{
+    for (int candidate = n; candidate > 2; --candidate) {
+        bool prime = true;
+        for (int d = 2; d * d <= candidate && prime; ++d)
+            prime = candidate % d != 0;
+        if (prime)
+            return candidate;
+    }
+    return n < 2 ? 1 : 2;
+}
+
+uint8_t hexToInt(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return 0;
+}
+
+} // namespace
+
+void CacheEngine::configure(int cacheSize, int blockSize, int associativity, int policy)
+{
+    m_cacheSize = cacheSize;
+    m_blockSize = blockSize > 0 ? blockSize : 1;
+    m_associativity = associativity;
+    m_policy = policy;
+
+    int numBlocks = cacheSize / m_blockSize;
+    if (numBlocks < 1)
+        numBlocks = 1;
+
+    // 0 -> fully associative; never more ways than there are blocks.
+    // Decoupled arrays multiply the tag ways, not the data blocks.
+    int dataWays = (associativity <= 0 || associativity > numBlocks) ? numBlocks : associativity;
+    m_tagRatio = m_requestedTagRatio > 1 ? m_requestedTagRatio : 1;
+    m_numSets = numBlocks / dataWays;
+    m_numWays = dataWays * m_tagRatio;
+    m_offsetBits = exactLog2(m_blockSize);
+    m_indexBits = exactLog2(m_numSets);
+    m_indexFunction = m_requestedIndexFunction;
+    setupIndexFunction();
+    m_accessCounter = 0;
+    m_stats = { 0, 0, 0, 0, 0, 0, 0 };
+
+    m_lines.assign(size_t(m_numSets) * m_numWays, Line{ -1, -1, -1 });
+    m_data.assign(m_storeData ? size_t(m_numSets) * dataWays * m_blockSize : 0, 0);
+    setupExtensions();
+}
+
+void CacheEngine::setupExtensions()
+{
+    // Sectors have to split a power-of-two block evenly
+    m_sectors = m_requestedSectors;
+    if (m_sectors < 1 || m_sectors > 64 || exactLog2(m_sectors) < 0 || m_offsetBits < 0 || m_sectors > m_blockSize)
+        m_sectors = 1;
+    m_sectorShift = m_offsetBits - exactLog2(m_sectors);
+
+    const size_t lines = m_lines.size();
+    const size_t slots = lines / size_t(m_tagRatio);
+    m_valid.assign(m_sectors > 1 || m_tagRatio > 1 ? lines : 0, 0);
+    m_dataSlot.assign(m_tagRatio > 1 ? lines : 0, -1);
+    m_slotOwner.assign(m_tagRatio > 1 ? slots : 0, -1);
+    m_slotUsed.assign(m_tagRatio > 1 ? slots : 0, 0);
+    m_clockHand = 0;
+
+    size_t entries = m_requestedVictimEntries > 0 ? size_t(m_requestedVictimEntries) : 0;
+    m_victim.assign(entries, VictimLine{ -1, -1, 0 });
+    m_victimData.assign(m_storeData ? entries * m_blockSize : 0, 0);
+    m_extended = !m_valid.empty() || !m_victim.empty();
+}
+
+void CacheEngine::setupIndexFunction()
+{
+    // XOR folding and skewing work on bit fields: they need a power-of-two
+    // number of sets, and with a single set there is nothing to hash
+    if (m_numSets == 1 || (m_indexBits < 0 && (m_indexFunction == XorFold || m_indexFunction == Skewed)))
+        m_indexFunction = Modulo;
+    if (m_indexFunction < Modulo || m_indexFunction > Skewed)
+        m_indexFunction = Modulo;
+
+    m_primeSets = m_numSets;
+    if (m_indexFunction == PrimeModulo) {
+        m_primeSets = largestPrimeUpTo(m_numSets);
+        m_primeMagic = UINT64_MAX / uint64_t(m_primeSets) + 1;
+    }
+}
+
+void CacheEngine::loadHexMemory(const char *hex)
+{
+    size_t length = std::strlen(hex);
+    m_memory.resize(length / 2);
+    for (size_t i = 0; i < m_memory.size(); ++i)
+        m_memory[i] = uint8_t((hexToInt(hex[i * 2]) << 4) | hexToInt(hex[i * 2 + 1]));
+}
+
+void CacheEngine::fillBytes(uint8_t *dst, int64_t start, int count) const
+{
+    // Anything outside the mock RAM reads as zero; copy whatever overlaps it
+    int64_t memorySize = int64_t(m_memory.size());
+    if (start >= 0 && start + count <= memorySize) {
+        std::memcpy(dst, &m_memory[size_t(start)], size_t(count));
+        return;
+    }
+    std::memset(dst, 0, size_t(count));
+    int64_t from = start < 0 ? 0 : start;
+    int64_t to = start + count < memorySize ? start + count : memorySize;
+    if (from < to)
+        std::memcpy(dst + (from - start), &m_memory[size_t(from)], size_t(to - from));
+}
+
+CacheEngine::AccessResult CacheEngine::access(int64_t byteAddress, int64_t indexAddress)
+{
+    AccessResult r;
+    r.blockAddress = blockOf(byteAddress);
+    r.byteOffset = offsetOf(byteAddress);
+    r.hit = false;
+    r.evicted = false;
+    r.victimHit = false;
+    r.sectorMiss = false;
+    r.evictedBlock = -1;
+    r.way = -1;
+
+    Line *set;
+    if (m_indexFunction == Skewed) {
+        r.way = probeSkewed(r.blockAddress, blockOf(indexAddress), &r.hit, &r.setIndex);
+        set = &m_lines[size_t(r.setIndex) * m_numWays];
+    } else {
+        r.setIndex = setIndexOf(blockOf(indexAddress));
+        set = &m_lines[size_t(r.setIndex) * m_numWays];
+        int emptyWay = -1;
+        for (int way = 0; way < m_numWays; ++way) {
+            if (set[way].block == r.blockAddress) {
+                r.hit = true;
+                r.way = way;
+                break;
+            }
+            if (emptyWay < 0 && set[way].block < 0)
+                emptyWay = way;
+        }
+        // Prefer an empty line, otherwise ask the replacement policy
+        if (!r.hit) {
+            r.way = emptyWay >= 0 ? emptyWay
+                                  : (m_policy == FIFO ? findReplacementWay_FIFO(r.setIndex)
+                                                      : findReplacementWay_LRU(r.setIndex));
+        }
+    }
+
+    const size_t line = size_t(r.setIndex) * m_numWays + r.way;
+    if (m_extended) {
+        extendedAccess(set, line, r);
+    } else if (r.hit) {
+        m_stats.hits++;
+        set[r.way].lastaccess = m_accessCounter;
+    } else {
+        m_stats.misses++;
+        if (set[r.way].block >= 0) {
+            r.evicted = true;
+            r.evictedBlock = set[r.way].block;
+            m_stats.evictions++;
+        }
+        set[r.way].block = r.blockAddress;
+        set[r.way].firstaccess = m_accessCounter;
+        set[r.way].lastaccess = m_accessCounter;
+        if (m_storeData)
+            fillBytes(&m_data[line * m_blockSize], r.blockAddress * m_blockSize, m_blockSize);
+        m_stats.fills++;
+        m_stats.bytesFetched += m_blockSize;
+    }
+
+    r.value = m_storeData ? m_data[size_t(slotOf(line)) * m_blockSize + r.byteOffset] : 0;
+    m_accessCounter++;
+    return r;
+}
+
+void CacheEngine::extendedAccess(Line *set, size_t line, AccessResult &r)
+{
+    const int sector = m_sectors > 1 ? (r.byteOffset >> m_sectorShift) : 0;
+    const uint64_t sectorBit = uint64_t(1) << sector;
+
+    // With sectors or decoupled data a matching tag isn't enough
+    if (r.hit && !m_valid.empty() && !(m_valid[line] & sectorBit)) {
+        r.hit = false;
+        r.sectorMiss = true;
+    }
+
+    if (r.hit) {
+        m_stats.hits++;
+        set[r.way].lastaccess = m_accessCounter;
+        if (!m_slotUsed.empty())
+            m_slotUsed[size_t(m_dataSlot[line])] = 1;
+        return;
+    }
+
+    m_stats.misses++;
+    bool fetch = true;
+    if (r.sectorMiss) {
+        m_stats.sectorMisses++;
+        set[r.way].lastaccess = m_accessCounter;
+        if (!m_dataSlot.empty() && m_dataSlot[line] < 0)
+            allocateSlot(line);
+    } else {
+        bool hadBlock = set[r.way].block >= 0;
+        if (hadBlock) {
+            r.evicted = true;
+            r.evictedBlock = set[r.way].block;
+            m_stats.evictions++;
+        }
+        if (!m_dataSlot.empty() && m_dataSlot[line] < 0)
+            allocateSlot(line);
+
+        // The old block goes to the victim cache, the new one may come from it
+        if (!m_victim.empty())
+            exchangeVictim(line, hadBlock, r);
+        else
+            m_valid[line] = 0;
+
+        set[r.way].block = r.blockAddress;
+        set[r.way].firstaccess = m_accessCounter;
+        set[r.way].lastaccess = m_accessCounter;
+        fetch = !r.victimHit || (!m_valid.empty() && !(m_valid[line] & sectorBit));
+    }
+
+    // Fill from the backing store: just the sector, or the whole block
+    if (fetch) {
+        const int64_t slot = slotOf(line);
+        const int count = m_blockSize / m_sectors;
+        const int start = sector * count;
+        if (m_storeData)
+            fillBytes(&m_data[size_t(slot) * m_blockSize + start], r.blockAddress * m_blockSize + start, count);
+        if (!m_valid.empty())
+            m_valid[line] |= sectorBit;
+        if (!m_slotUsed.empty())
+            m_slotUsed[size_t(slot)] = 1;
+        m_stats.fills++;
+        m_stats.bytesFetched += count;
+    }
+}
+
+void CacheEngine::exchangeVictim(size_t line, bool hadBlock, AccessResult &r)
+{
+    const uint64_t lineValid = m_valid.empty() ? ~uint64_t(0) : m_valid[line];
+    const bool park = hadBlock && lineValid != 0;
+
+    int entry = -1;
+    for (size_t i = 0; i < m_victim.size(); ++i) {
+        if (m_victim[i].block == r.blockAddress) {
+            entry = int(i);
+            break;
+        }
+    }
+    if (entry >= 0) {
+        r.victimHit = true;
+        m_stats.victimHits++;
+    } else if (park) {
+        // Empty entry first, then the least recently parked one (dropped for good)
+        entry = 0;
+        for (size_t i = 0; i < m_victim.size(); ++i) {
+            if (m_victim[i].block < 0) {
+                entry = int(i);
+                break;
+            }
+            if (m_victim[i].lastaccess < m_victim[size_t(entry)].lastaccess)
+                entry = int(i);
+        }
+    }
+
+    uint64_t incomingValid = 0;
+    if (entry >= 0) {
+        VictimLine &victim = m_victim[size_t(entry)];
+        incomingValid = victim.valid;
+        victim = park ? VictimLine{ m_lines[line].block, m_accessCounter, lineValid } : VictimLine{ -1, -1, 0 };
+
+        if (m_storeData) {
+            uint8_t *lineBytes = &m_data[size_t(slotOf(line)) * m_blockSize];
+            uint8_t *victimBytes = &m_victimData[size_t(entry) * m_blockSize];
+            if (park && r.victimHit)
+                std::swap_ranges(lineBytes, lineBytes + m_blockSize, victimBytes);
+            else if (park)
+                std::memcpy(victimBytes, lineBytes, size_t(m_blockSize));
+            else
+                std::memcpy(lineBytes, victimBytes, size_t(m_blockSize));
+        }
+    }
+    if (!m_valid.empty())
+        m_valid[line] = r.victimHit ? incomingValid : 0;
+}
+
+int64_t CacheEngine::allocateSlot(size_t line)
+{
+    // CLOCK over the data blocks: recently used ones get a second chance.
+    // The line that loses its block keeps its tag, with nothing valid.
+    const int64_t slots = int64_t(m_slotOwner.size());
+    for (;;) {
+        int64_t slot = m_clockHand;
+        m_clockHand = (m_clockHand + 1 == slots) ? 0 : m_clockHand + 1;
+        int64_t owner = m_slotOwner[size_t(slot)];
+        if (owner >= 0 && m_slotUsed[size_t(slot)]) {
+            m_slotUsed[size_t(slot)] = 0;
+            continue;
+        }
+        if (owner >= 0) {
+            m_dataSlot[size_t(owner)] = -1;
+            m_valid[size_t(owner)] = 0;
+        }
+        m_slotOwner[size_t(slot)] = int64_t(line);
+        m_slotUsed[size_t(slot)] = 1;
+        m_dataSlot[line] = slot;
+        return slot;
+    }
+}
+
+void CacheEngine::run(const int64_t *byteAddresses, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        access(byteAddresses[i]);
+}
+
+bool CacheEngine::contains(int64_t byteAddress) const
+{
+    int64_t blockAddress = blockOf(byteAddress);
+    if (m_indexFunction == Skewed) {
+        bool hit = false;
+        int setIndex;
+        probeSkewed(blockAddress, blockAddress, &hit, &setIndex);
+        return hit;
+    }
+    const Line *set = &m_lines[size_t(setIndexOf(blockAddress)) * m_numWays];
+    for (int way = 0; way < m_numWays; ++way) {
+        if (set[way].block == blockAddress)
+            return true;
+    }
+    return false;
+}
+
+void CacheEngine::warm(int64_t byteAddress)
+{
+    // The extensions need all of access()'s bookkeeping; just drop its totals
+    if (m_extended) {
+        Stats saved = m_stats;
+        bool storeData = m_storeData;
+        m_storeData = false;
+        access(byteAddress);
+        m_storeData = storeData;
+        m_stats = saved;
+        return;
+    }
+
+    int64_t blockAddress = blockOf(byteAddress);
+
+    if (m_indexFunction == Skewed) {
+        bool hit;
+        int setIndex;
+        int way = probeSkewed(blockAddress, blockAddress, &hit, &setIndex);
+        Line &line = m_lines[size_t(setIndex) * m_numWays + way];
+        if (!hit) {
+            line.block = blockAddress;
+            line.firstaccess = m_accessCounter;
+        }
+        line.lastaccess = m_accessCounter++;
+        return;
+    }
+
+    Line *set = &m_lines[size_t(setIndexOf(blockAddress)) * m_numWays];
+
+    int emptyWay = -1;
+    for (int way = 0; way < m_numWays; ++way) {
+        if (set[way].block == blockAddress) {
+            set[way].lastaccess = m_accessCounter++;
+            return;
+        }
+        if (emptyWay < 0 && set[way].block < 0)
+            emptyWay = way;
+    }
+
+    int way = emptyWay;
+    if (way < 0) {
+        way = (m_policy == FIFO) ? findReplacementWay_FIFO(setIndexOf(blockAddress))
+                                 : findReplacementWay_LRU(setIndexOf(blockAddress));
+    }
+    set[way].block = blockAddress;
+    set[way].firstaccess = m_accessCounter;
+    set[way].lastaccess = m_accessCounter;
+    m_accessCounter++;
+}
+
+int CacheEngine::hashedSetIndex(int64_t blockAddress, int way) const
+{
+    const uint64_t block = uint64_t(blockAddress);
+    const uint64_t mask = uint64_t(m_numSets) - 1;
+
+    switch (m_indexFunction) {
+    case XorFold: {
+        // Prefix XOR: afterwards the low indexBits are the XOR of every
+        // indexBits-wide chunk of the block address
+        uint64_t x = block;
+        for (int shift = m_indexBits; shift < 64; shift <<= 1)
+            x ^= x >> shift;
+        return int(x & mask);
+    }
+    case PrimeModulo:
+        if (block <= 0xFFFFFFFFull) {
+            // Lemire's fastmod: two multiplies instead of a division
+            uint64_t low = m_primeMagic * block;
+            uint64_t high = ((low >> 32) * uint64_t(m_primeSets)
+                             + (((low & 0xFFFFFFFFull) * uint64_t(m_primeSets)) >> 32)) >> 32;
+            return int(high);
+        }
+        return int(block % uint64_t(m_primeSets));
+    case Skewed: {
+        // Low index bits XOR the next ones rotated by a different amount per way
+        const int n = m_indexBits;
+        uint64_t high = (block >> n) & mask;
+        int rotate = way % n;
+        uint64_t rotated = ((high << rotate) | (high >> (n - rotate))) & mask;
+        return int((block & mask) ^ rotated);
+    }
+    case Modulo:
+        break;
+    }
+    return static_cast<int>(m_indexBits >= 0 ? (blockAddress & (m_numSets - 1)) : blockAddress % m_numSets);
+}
+
+int CacheEngine::probeSkewed(int64_t blockAddress, int64_t indexBlock, bool *hit, int *setIndex) const
+{
+    int emptyWay = -1;
+    int emptySet = 0;
+    int victimWay = -1;
+    int victimSet = 0;
+    int64_t victimAge = 0;
+
+    // hashedSetIndex() for Skewed, with the per-block part done once
+    const int n = m_indexBits;
+    const uint64_t mask = uint64_t(m_numSets) - 1;
+    const uint64_t low = uint64_t(indexBlock) & mask;
+    const uint64_t high = (uint64_t(indexBlock) >> n) & mask;
+
+    for (int way = 0, rotate = 0; way < m_numWays; ++way, rotate = (rotate + 1 == n ? 0 : rotate + 1)) {
+        int set = int(low ^ (((high << rotate) | (high >> (n - rotate))) & mask));
+        const Line &line = m_lines[size_t(set) * m_numWays + way];
+        if (line.block == blockAddress) {
+            *hit = true;
+            *setIndex = set;
+            return way;
+        }
+        if (line.block < 0) {
+            if (emptyWay < 0) {
+                emptyWay = way;
+                emptySet = set;
+            }
+            continue;
+        }
+        // The candidates come from different sets, so compare them directly
+        int64_t age = (m_policy == FIFO) ? line.firstaccess : line.lastaccess;
+        if (victimWay < 0 || age < victimAge) {
+            victimWay = way;
+            victimSet = set;
+            victimAge = age;
+        }
+    }
+
+    *hit = false;
+    if (emptyWay >= 0) {
+        *setIndex = emptySet;
+        return emptyWay;
+    }
+    *setIndex = victimSet;
+    return victimWay;
+}
+
+int CacheEngine::findReplacementWay_LRU(int setIndex) const
+{
+    // LRU: the way with the smallest lastaccess value
+    const Line *set = &m_lines[size_t(setIndex) * m_numWays];
+    int lruWay = 0;
+    for (int way = 1; way < m_numWays; ++way) {
+        if (set[way].lastaccess < set[lruWay].lastaccess)
+            lruWay = way;
+    }
+    return lruWay;
+}
+
+int CacheEngine::findReplacementWay_FIFO(int setIndex) const
+{
+    // FIFO: the way with the smallest firstaccess value (oldest fill)
+    const Line *set = &m_lines[size_t(setIndex) * m_numWays];
+    int fifoWay = 0;
+    for (int way = 1; way < m_numWays; ++way) {
+        if (set[way].firstaccess < set[fifoWay].firstaccess)
+            fifoWay = way;
+    }
+    return fifoWay;
+}
+
+bool CacheEngine::saveCheckpoint(const std::string &path, std::string *error) const
+{
+    CheckpointHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.version = CHECKPOINT_VERSION;
+    header.headerSize = sizeof(CheckpointHeader);
+    header.cacheSize = m_cacheSize;
+    header.blockSize = m_blockSize;
+    header.associativity = m_associativity;
+    header.policy = m_policy;
+    header.numSets = m_numSets;
+    header.numWays = m_numWays;
+    header.accessCounter = m_accessCounter;
+    header.hits = m_stats.hits;
+    header.misses = m_stats.misses;
+    header.evictions = m_stats.evictions;
+    header.lineCount = m_lines.size();
+    header.dataBytes = m_data.size();
+    header.indexFunction = m_indexFunction;
+    header.victimEntries = int32_t(m_victim.size());
+    header.sectors = m_sectors;
+    header.tagRatio = m_tagRatio;
+    header.victimHits = m_stats.victimHits;
+    header.sectorMisses = m_stats.sectorMisses;
+    header.fills = m_stats.fills;
+    header.bytesFetched = m_stats.bytesFetched;
+    header.clockHand = m_clockHand;
+
+    FILE *f = std::fopen(path.c_str(), "wb");
+    if (!f) {
+        setError(error, "cannot open " + path + " for writing");
+        return false;
+    }
+
+    // One write per contiguous array
+    bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1
+              && std::fwrite(m_lines.data(), sizeof(Line), m_lines.size(), f) == m_lines.size()
+              && std::fwrite(m_data.data(), 1, m_data.size(), f) == m_data.size()
+              && std::fwrite(m_valid.data(), sizeof(uint64_t), m_valid.size(), f) == m_valid.size()
+              && std::fwrite(m_dataSlot.data(), sizeof(int64_t), m_dataSlot.size(), f) == m_dataSlot.size()
+              && std::fwrite(m_slotUsed.data(), 1, m_slotUsed.size(), f) == m_slotUsed.size()
+              && std::fwrite(m_victim.data(), sizeof(VictimLine), m_victim.size(), f) == m_victim.size()
+              && std::fwrite(m_victimData.data(), 1, m_victimData.size(), f) == m_victimData.size();
+    ok = (std::fclose(f) == 0) && ok;
+    if (!ok)
+        setError(error, "short write to " + path);
+    return ok;
+}
+
+bool CacheEngine::loadCheckpoint(const std::string &path, std::string *error)
+{
+    MappedFile file(path);
+    if (!file.data()) {
+        setError(error, "cannot read " + path);
+        return false;
+    }
+
+    // Older headers are a prefix of the current one
+    CheckpointHeader header;
+    std::memset(&header, 0, sizeof(header));
+    if (file.size() < CHECKPOINT_V2_HEADER_SIZE) {
+        setError(error, path + " is too small to be a checkpoint");
+        return false;
+    }
+    std::memcpy(&header, file.data(), CHECKPOINT_V2_HEADER_SIZE);
+
+    if (std::memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) != 0) {
+        setError(error, path + " is not a cache checkpoint");
+        return false;
+    }
+    bool known = (header.version == 2 && header.headerSize == CHECKPOINT_V2_HEADER_SIZE)
+                 || (header.version == 3 && header.headerSize == CHECKPOINT_V3_HEADER_SIZE)
+                 || (header.version == CHECKPOINT_VERSION && header.headerSize == sizeof(CheckpointHeader));
+    if (!known || file.size() < header.headerSize) {
+        setError(error, "unsupported checkpoint version " + std::to_string(header.version));
+        return false;
+    }
+    std::memcpy(&header, file.data(), header.headerSize);
+    if (header.version < 4) {
+        header.sectors = 1;
+        header.tagRatio = 1;
+    }
+
+    // Sizes of the optional arrays follow from the extension settings
+    const int sectorBits = exactLog2(header.sectors);
+    const bool extensionsOk = header.victimEntries >= 0 && header.victimEntries <= (1 << 20)
+                              && sectorBits >= 0 && header.sectors <= 64
+                              && (header.sectors == 1 || (exactLog2(header.blockSize) >= 0 && header.sectors <= header.blockSize))
+                              && header.tagRatio >= 1 && header.numWays % header.tagRatio == 0;
+    const uint64_t slots = extensionsOk ? header.lineCount / uint64_t(header.tagRatio) : 0;
+    const uint64_t validCount = header.sectors > 1 || header.tagRatio > 1 ? header.lineCount : 0;
+    const uint64_t slotCount = header.tagRatio > 1 ? header.lineCount : 0;
+    const uint64_t victimBytes = header.dataBytes != 0 ? uint64_t(header.victimEntries) * uint64_t(header.blockSize) : 0;
+    if (!extensionsOk || header.blockSize <= 0 || header.numSets <= 0 || header.numWays <= 0
+        || header.lineCount != uint64_t(header.numSets) * uint64_t(header.numWays)
+        || (header.dataBytes != 0 && header.dataBytes != slots * uint64_t(header.blockSize))
+        || file.size() != header.headerSize + header.lineCount * sizeof(Line) + header.dataBytes
+                              + validCount * sizeof(uint64_t) + slotCount * sizeof(int64_t)
+                              + (slotCount != 0 ? slots : 0)
+                              + uint64_t(header.victimEntries) * sizeof(VictimLine) + victimBytes) {
+        setError(error, path + " is truncated or inconsistent");
+        return false;
+    }
+
+    // Every data block belongs to at most one line, and only lines with a
+    // block may have valid sectors
+    if (slotCount != 0) {
+        const uint8_t *masks = file.data() + header.headerSize + header.lineCount * sizeof(Line) + header.dataBytes;
+        const uint8_t *lineSlots = masks + validCount * sizeof(uint64_t);
+        std::vector<uint8_t> taken(size_t(slots), 0);
+        for (uint64_t line = 0; line < slotCount; ++line) {
+            int64_t slot;
+            uint64_t valid;
+            std::memcpy(&slot, lineSlots + line * sizeof(int64_t), sizeof(slot));
+            std::memcpy(&valid, masks + line * sizeof(uint64_t), sizeof(valid));
+            bool ok = slot >= 0 ? (uint64_t(slot) < slots && !taken[size_t(slot)]) : (slot == -1 && valid == 0);
+            if (!ok) {
+                setError(error, path + " has a corrupt data slot table");
+                return false;
+            }
+            if (slot >= 0)
+                taken[size_t(slot)] = 1;
+        }
+    }
+
+    m_cacheSize = header.cacheSize;
+    m_blockSize = header.blockSize;
+    m_associativity = header.associativity;
+    m_policy = header.policy;
+    m_numSets = header.numSets;
+    m_numWays = header.numWays;
+    m_storeData = header.dataBytes != 0;
+    m_offsetBits = exactLog2(m_blockSize);
+    m_indexBits = exactLog2(m_numSets);
+    m_indexFunction = header.indexFunction;
+    m_requestedIndexFunction = header.indexFunction;
+    setupIndexFunction();
+    m_accessCounter = header.accessCounter;
+    m_stats = { header.hits, header.misses, header.evictions, header.victimHits,
+                header.sectorMisses, header.fills, header.bytesFetched };
+
+    const uint8_t *p = file.data() + header.headerSize;
+    m_lines.resize(size_t(header.lineCount));
+    std::memcpy(m_lines.data(), p, m_lines.size() * sizeof(Line));
+    p += m_lines.size() * sizeof(Line);
+    m_data.assign(p, p + header.dataBytes);
+    p += header.dataBytes;
+
+    m_requestedVictimEntries = header.victimEntries;
+    m_requestedSectors = header.sectors;
+    m_requestedTagRatio = header.tagRatio;
+    m_tagRatio = header.tagRatio;
+    setupExtensions();
+    std::memcpy(m_valid.data(), p, m_valid.size() * sizeof(uint64_t));
+    p += m_valid.size() * sizeof(uint64_t);
+    std::memcpy(m_dataSlot.data(), p, m_dataSlot.size() * sizeof(int64_t));
+    p += m_dataSlot.size() * sizeof(int64_t);
+    std::memcpy(m_slotUsed.data(), p, m_slotUsed.size());
+    p += m_slotUsed.size();
+    std::memcpy(m_victim.data(), p, m_victim.size() * sizeof(VictimLine));
+    p += m_victim.size() * sizeof(VictimLine);
+    std::memcpy(m_victimData.data(), p, m_victimData.size());
+
+    // Slot owners are rebuilt from the per-line slots
+    for (size_t line = 0; line < m_dataSlot.size(); ++line) {
+        if (m_dataSlot[line] >= 0)
+            m_slotOwner[size_t(m_dataSlot[line])] = int64_t(line);
+    }
+    if (!m_slotOwner.empty())
+        m_clockHand = header.clockHand >= 0 && header.clockHand < int64_t(m_slotOwner.size()) ? header.clockHand : 0;
+    return true;
+}
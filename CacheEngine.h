@@ -0,0 +1,244 @@
+#ifndef CACHEENGINE_H
+#define CACHEENGINE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The cache model itself, without any Qt or drawing code.
+// MainWindow keeps one of these and only explains what it does.
+//
+// All state lives in two flat arrays indexed by (set * ways + way):
+// one for the line metadata and one for the block bytes. That keeps
+// lookups cache friendly and lets a checkpoint be a plain dump of them.
+//
+// Optional structural extensions, all off by default:
+//  - a small fully associative victim cache that catches evicted blocks
+//    and is probed on every miss
+//  - sectored lines: one tag per block but a valid bit per sector, so a
+//    miss only fetches the sector it needs
+//  - decoupled tag and data arrays: more tags than data blocks, with data
+//    blocks handed out to lines on demand (CLOCK picks the one to take)
+// Lines that may be missing data keep a valid mask next to the line array;
+// with decoupled arrays each line also points at its data block.
+class CacheEngine
+{
+public:
+    // Same values as the "replacement" combo box in MainWindow
+    enum ReplacementPolicy {
+        LRU = 5,
+        FIFO = 6
+    };
+
+    // How a block address picks its set. Modulo is the textbook
+    // "block mod sets"; the others spread power-of-two strides out.
+    enum IndexFunction {
+        Modulo = 0,
+        XorFold = 1,       // XOR of all index-wide chunks of the block address
+        PrimeModulo = 2,   // block mod the largest prime <= sets (the rest stay unused)
+        Skewed = 3         // a different XOR hash in every way (skewed-associative)
+    };
+
+    struct Line {
+        int64_t block;        // full block address, -1 while the line is empty
+        int64_t lastaccess;
+        int64_t firstaccess;
+    };
+
+    // A line parked in the victim cache
+    struct VictimLine {
+        int64_t block;        // -1 while empty
+        int64_t lastaccess;
+        uint64_t valid;       // sector valid mask it had in the cache
+    };
+
+    struct AccessResult {
+        bool hit;
+        bool evicted;          // a valid line had to be replaced
+        bool victimHit;        // missed, but the block came back from the victim cache
+        bool sectorMiss;       // the tag was there, the sector wasn't
+        int setIndex;
+        int way;
+        int64_t blockAddress;
+        int byteOffset;
+        int64_t evictedBlock;  // -1 unless evicted
+        uint8_t value;         // the byte that was read (0 without data)
+    };
+
+    // Running totals since configure()
+    struct Stats {
+        int64_t hits;
+        int64_t misses;          // including victim hits and sector misses
+        int64_t evictions;
+        int64_t victimHits;
+        int64_t sectorMisses;
+        int64_t fills;           // trips to memory
+        int64_t bytesFetched;    // bytes those trips moved
+    };
+
+    // associativity 0 means fully associative (same marker as the GUI)
+    void configure(int cacheSize, int blockSize, int associativity, int policy);
+
+    // Without data the engine only tracks tags (hit/miss behaviour), which
+    // is all the command-line tools need. Takes effect at the next configure().
+    void setStoreData(bool store) { m_storeData = store; }
+    bool storesData() const { return m_storeData; }
+
+    // Takes effect at the next configure(). XorFold and Skewed need a
+    // power-of-two number of sets and quietly fall back to Modulo otherwise.
+    void setIndexFunction(int function) { m_requestedIndexFunction = function; }
+    int indexFunction() const { return m_indexFunction; }
+
+    // Sets that can actually be used: numSets(), or the prime for PrimeModulo
+    int indexedSets() const { return m_primeSets; }
+
+    // Structural extensions; each takes effect at the next configure().
+    // entries = 0: no victim cache
+    void setVictimCache(int entries) { m_requestedVictimEntries = entries; }
+    // sectors per block: a power of two up to 64 that divides the block size, 1 = whole blocks
+    void setSectors(int sectors) { m_requestedSectors = sectors; }
+    // tags per data block: 1 = classic coupled arrays, 2 = twice the tags (ways) for the same data
+    void setTagRatio(int ratio) { m_requestedTagRatio = ratio; }
+
+    int victimEntries() const { return int(m_victim.size()); }
+    int sectors() const { return m_sectors; }
+    int sectorSize() const { return m_blockSize / m_sectors; }
+    int tagRatio() const { return m_tagRatio; }
+
+    // Backing store given as a hex string, two characters per byte
+    void loadHexMemory(const char *hex);
+
+    // byteAddress must not be negative
+    AccessResult access(int64_t byteAddress) { return access(byteAddress, byteAddress); }
+
+    // Same, but the set is picked from indexAddress while the line is still
+    // identified by byteAddress. That is a virtually indexed, physically
+    // tagged lookup when given (physical, virtual); see Mmu.
+    AccessResult access(int64_t byteAddress, int64_t indexAddress);
+
+    // Run a chunk of byte addresses through access(), e.g. straight from
+    // WorkloadGenerator or a trace file, without building any explanation
+    void run(const int64_t *byteAddresses, size_t count);
+
+    // Functional warming: updates tags and LRU/FIFO info like access() but
+    // skips the data copy and the totals. Lines filled this way hold stale
+    // bytes, so only use it where hit/miss behaviour is all that matters.
+    void warm(int64_t byteAddress);
+
+    // Whether the tag of byteAddress's block is in the cache. Changes
+    // nothing, not even LRU order, so a lookup can be tried before deciding
+    // what to allocate.
+    bool contains(int64_t byteAddress) const;
+
+    int cacheSize() const { return m_cacheSize; }
+    int blockSize() const { return m_blockSize; }
+    int associativity() const { return m_associativity; }
+    int policy() const { return m_policy; }
+    int numSets() const { return m_numSets; }
+    int numWays() const { return m_numWays; }
+    int64_t accessCounter() const { return m_accessCounter; }
+    const Stats &stats() const { return m_stats; }
+
+    // Power-of-two sizes (everything the GUI offers) use the precomputed
+    // shifts and masks; other sizes fall back to division.
+    int64_t blockOf(int64_t byteAddress) const
+    {
+        return m_offsetBits >= 0 ? (byteAddress >> m_offsetBits) : byteAddress / m_blockSize;
+    }
+    int offsetOf(int64_t byteAddress) const
+    {
+        return static_cast<int>(m_offsetBits >= 0 ? (byteAddress & (m_blockSize - 1)) : byteAddress % m_blockSize);
+    }
+    int setIndexOf(int64_t blockAddress) const
+    {
+        if (m_indexFunction != Modulo)
+            return hashedSetIndex(blockAddress, 0);
+        return static_cast<int>(m_indexBits >= 0 ? (blockAddress & (m_numSets - 1)) : blockAddress % m_numSets);
+    }
+    // The set the block would use in this way; only Skewed differs per way
+    int setIndexOf(int64_t blockAddress, int way) const
+    {
+        return m_indexFunction == Skewed ? hashedSetIndex(blockAddress, way) : setIndexOf(blockAddress);
+    }
+    // The hashes keep the low index bits recoverable from the set, so the
+    // tag is still what is left above them (or the quotient for PrimeModulo)
+    int64_t tagOf(int64_t blockAddress) const
+    {
+        if (m_indexFunction == PrimeModulo)
+            return blockAddress / m_primeSets;
+        return m_indexBits >= 0 ? (blockAddress >> m_indexBits) : blockAddress / m_numSets;
+    }
+
+    const Line &line(int set, int way) const { return m_lines[set * m_numWays + way]; }
+    // nullptr when a decoupled line has no data block right now
+    const uint8_t *lineData(int set, int way) const
+    {
+        int64_t slot = slotOf(size_t(set) * m_numWays + way);
+        return slot < 0 ? nullptr : &m_data[size_t(slot) * m_blockSize];
+    }
+    // Sector valid mask; all sectors are valid when nothing is tracked
+    uint64_t lineValid(int set, int way) const
+    {
+        return m_valid.empty() ? ~uint64_t(0) : m_valid[size_t(set) * m_numWays + way];
+    }
+    const VictimLine &victimLine(int entry) const { return m_victim[size_t(entry)]; }
+    const uint8_t *victimLineData(int entry) const { return &m_victimData[size_t(entry) * m_blockSize]; }
+
+    int findReplacementWay_LRU(int setIndex) const;
+    int findReplacementWay_FIFO(int setIndex) const;
+
+    // Binary snapshot of the whole engine state (config, counters, totals, lines, data).
+    // Returns false and fills error when the file can't be written / read.
+    bool saveCheckpoint(const std::string &path, std::string *error = nullptr) const;
+    bool loadCheckpoint(const std::string &path, std::string *error = nullptr);
+
+private:
+    void fillBytes(uint8_t *dst, int64_t start, int count) const;
+    void setupExtensions();
+    int64_t slotOf(size_t line) const { return m_dataSlot.empty() ? int64_t(line) : m_dataSlot[line]; }
+    int64_t allocateSlot(size_t line);
+    // Hit/miss handling of access() once any extension is on
+    void extendedAccess(Line *set, size_t line, AccessResult &r);
+    void exchangeVictim(size_t line, bool hadBlock, AccessResult &r);
+    void setupIndexFunction();
+    int hashedSetIndex(int64_t blockAddress, int way) const;
+    // Skewed lookup: returns the hit way, or the way to fill, and its set
+    int probeSkewed(int64_t blockAddress, int64_t indexBlock, bool *hit, int *setIndex) const;
+
+    int m_cacheSize = 0;
+    int m_blockSize = 1;
+    int m_associativity = 0;
+    int m_policy = LRU;
+    bool m_storeData = true;
+    int m_numSets = 1;
+    int m_numWays = 0;
+    int m_offsetBits = 0;   // log2(blockSize), -1 if not a power of two
+    int m_indexBits = 0;    // log2(numSets), -1 if not a power of two
+    int m_requestedIndexFunction = Modulo;
+    int m_indexFunction = Modulo;
+    int m_primeSets = 1;    // PrimeModulo divisor (numSets otherwise)
+    uint64_t m_primeMagic = 0;
+    int64_t m_accessCounter = 0;
+    Stats m_stats = { 0, 0, 0, 0, 0, 0, 0 };
+
+    int m_requestedVictimEntries = 0;
+    int m_requestedSectors = 1;
+    int m_requestedTagRatio = 1;
+    int m_sectors = 1;
+    int m_sectorShift = 0;  // log2(sector size)
+    int m_tagRatio = 1;
+    bool m_extended = false;  // any of the three on
+
+    std::vector<Line> m_lines;      // [set * ways + way]
+    std::vector<uint8_t> m_data;    // [slot * blockSize + byte], empty without data; slot = line unless decoupled
+    std::vector<uint64_t> m_valid;  // [line] sector valid mask, only with sectors or decoupled arrays
+    std::vector<int64_t> m_dataSlot;   // [line] data slot or -1, only when decoupled
+    std::vector<int64_t> m_slotOwner;  // [slot] line or -1
+    std::vector<uint8_t> m_slotUsed;   // [slot] CLOCK reference bit
+    int64_t m_clockHand = 0;
+    std::vector<VictimLine> m_victim;
+    std::vector<uint8_t> m_victimData;  // [entry * blockSize + byte]
+    std::vector<uint8_t> m_memory;  // decoded backing store
+};
+
+#endif // CACHEENGINE_H
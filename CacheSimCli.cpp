@@ -0,0 +1,764 @@
+// cachesim-cli: runs trace files through the cache engine without a GUI
+// and prints one line of statistics per trace.
+//
+//   cachesim-cli --cache-size 32K --block-size 64 --ways 8 a.txt b.bin
+//
+// Several traces are simulated in parallel, one engine per trace.
+// Run with --help for all options.
+
+#include "CacheEngine.h"
+#include "ConflictProfiler.h"
+#include "IntervalStats.h"
+#include "Mmu.h"
+#include "TimingModel.h"
+#include "Sampling.h"
+#include "Trace.h"
+#include "TraceContainer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const size_t CHUNK = 1 << 16;
+
+// Misses per conflict profiler sample unless --profile asks for all of them
+const int PROFILE_SAMPLE = 16;
+
+struct Options {
+    int cacheSize = 32 * 1024;
+    int blockSize = 64;
+    int ways = 8;
+    int policy = CacheEngine::LRU;
+    int indexFunction = CacheEngine::Modulo;
+    int victimEntries = 0;
+    int sectors = 1;
+    int tagRatio = 1;
+    TraceReader::Format format = TraceReader::Auto;
+    int jobs = 0;                    // 0 -> one per core
+    bool csv = false;
+
+    int intervals = 0;               // > 0: write <trace>.intervals.csv
+    bool profile = true;             // write <trace>.profile.txt (dropped for sampled runs)
+    bool profileAll = false;         // --profile: every miss, not 1 in PROFILE_SAMPLE
+    int sampleSets = 0;              // > 0: set sampling, 1 set in N
+    int64_t samplePeriod = 0;        // > 0: interval sampling
+    int64_t sampleWarmup = 0;
+    int64_t sampleMeasure = 0;
+
+    bool translate = false;          // virtual addresses through Mmu
+    Mmu::Config mmu;
+
+    bool timing = false;             // cycle-approximate timing
+    TimingModel::Config timingConfig;
+
+    std::string loadCheckpoint;
+    std::string saveCheckpoint;
+    std::string cacheOption;         // first cache configuration option given, if any
+    std::string pack;                // write the trace back as a .ctz
+    TraceCodec packCodec = defaultTraceCodec();
+    std::vector<std::string> traces;
+};
+
+struct Result {
+    bool ok = false;
+    std::string error;
+    CacheEngine::Stats stats = { 0, 0, 0, 0, 0, 0, 0 };
+    int64_t accesses = 0;
+    int blockSize = 0;
+    bool extensions = false;         // victim cache, sectors or extra tags configured
+    size_t skippedLines = 0;
+    std::string profileError;        // the default profile couldn't be written
+    int phases = 0;
+    bool sampled = false;
+    SampleEstimate estimate = {};
+    Mmu::Stats tlb = {};
+    bool synonyms = false;
+    TimingModel::Stats timing = {};
+    double amat = 0;
+    double bandwidth = 0;            // GB/s
+};
+
+void printUsage(FILE *out)
+{
+    std::fprintf(out,
+        "usage: cachesim-cli [options] trace...\n"
+        "\n"
+        "Traces are text (\"Read Byte N\" per line), raw little-endian 64-bit\n"
+        "addresses for *.bin, packed traces from cachesim-capture (*.ctr) or\n"
+        "compressed traces (*.ctz, see --pack).\n"
+        "\n"
+        "cache:\n"
+        "  --cache-size SIZE       total size, e.g. 4096, 32K, 8M (default 32K)\n"
+        "  --block-size SIZE       block size (default 64)\n"
+        "  --ways N                associativity, 0 = fully associative (default 8)\n"
+        "  --policy lru|fifo       replacement policy (default lru)\n"
+        "  --index modulo|xor|prime|skewed  set index function (default modulo)\n"
+        "  --victim N              N-entry fully associative victim cache (default none)\n"
+        "  --sectors N             N valid bits per block; misses fetch one sector (default 1)\n"
+        "  --tag-ratio N           N tags per data block, data handed out on demand (default 1)\n"
+        "  --load-checkpoint FILE  start every run from this checkpoint instead; the cache\n"
+        "                          configuration comes from the file, so none of the\n"
+        "                          options above may be given with it\n"
+        "  --save-checkpoint FILE  save the final state (single trace only)\n"
+        "\n"
+        "virtual memory (any of these turns address translation on):\n"
+        "  --page-size 4K|2M|1G    page size (default 4K)\n"
+        "  --l1-tlb ENTRIES:WAYS   L1 TLB (default 64:4)\n"
+        "  --l2-tlb ENTRIES:WAYS   L2 TLB, 0:0 for none (default 1536:12)\n"
+        "  --pwc N                 page-walk cache entries, 0 for none (default 32)\n"
+        "  --indexing pipt|vipt    how the cache picks the set (default pipt)\n"
+        "  Page-table reads go through the cache and count in its hits/misses.\n"
+        "\n"
+        "timing (any of these turns the timing model on):\n"
+        "  --timing                cycles, AMAT and DRAM bandwidth with the defaults below\n"
+        "  --hit-latency N         cycles per cache hit (default 4)\n"
+        "  --mshrs N               misses in flight at once (default 8)\n"
+        "  --dram BANKS:ROW        DRAM banks and row size (default 16:8K)\n"
+        "  --dram-latency HIT:MISS cycles for an open-row hit / a row miss (default 45:135)\n"
+        "  --bandwidth N           DRAM bus bytes per cycle (default 8)\n"
+        "  --clock GHZ             core clock, for GB/s (default 3)\n"
+        "\n"
+        "statistics:\n"
+        "  --intervals N           write TRACE.intervals.csv with one row per N accesses\n"
+        "  --no-profile            don't write TRACE.profile.txt. Every full run writes it by\n"
+        "                          default: hottest sets, most missed blocks, conflicting\n"
+        "                          block pairs and address ranges thrashing sets, counted\n"
+        "                          on 1 in 16 misses\n"
+        "  --profile               count every miss for it (slower on miss-heavy traces)\n"
+        "  --sample-sets N         set sampling: simulate 1 set in N\n"
+        "  --sample-intervals P:W:U  interval sampling: every P accesses warm W, measure U\n"
+        "\n"
+        "output:\n"
+        "  --format auto|text|binary|packed|compressed  trace format (default auto)\n"
+        "  --pack FILE             also write the trace to FILE as a compressed trace\n"
+        "                          (single trace only)\n"
+        "  --codec zstd|lz4|none   compression for --pack (default %s)\n"
+        "  --jobs N                traces simulated in parallel (default: all cores)\n"
+        "  --csv                   comma-separated output\n"
+        "  --help\n", traceCodecName(defaultTraceCodec()));
+}
+
+// "32K" -> 32768, "8M" -> 8388608; -1 if it isn't a size
+int64_t parseSize(const char *text)
+{
+    char *end = nullptr;
+    long long value = std::strtoll(text, &end, 10);
+    if (end == text || value < 0)
+        return -1;
+    int64_t scale = 1;
+    switch (std::toupper(static_cast<unsigned char>(*end))) {
+    case 'K': scale = 1024; ++end; break;
+    case 'M': scale = 1024 * 1024; ++end; break;
+    case 'G': scale = 1024 * 1024 * 1024; ++end; break;
+    default: break;
+    }
+    if (std::toupper(static_cast<unsigned char>(*end)) == 'B')
+        ++end;
+    return *end ? -1 : value * scale;
+}
+
+// Options a checkpoint brings its own value for
+bool isCacheOption(const std::string &arg)
+{
+    static const char *const names[] = {
+        "--cache-size", "--block-size", "--ways", "--policy", "--index", "--victim", "--sectors", "--tag-ratio"
+    };
+    for (const char *name : names) {
+        if (arg == name)
+            return true;
+    }
+    return false;
+}
+
+bool parseOptions(int argc, char *argv[], Options &o)
+{
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (o.cacheOption.empty() && isCacheOption(arg))
+            o.cacheOption = arg;
+        auto value = [&](const char *name) -> const char * {
+            if (i + 1 >= argc) {
+                std::fprintf(stderr, "cachesim-cli: %s needs a value\n", name);
+                return nullptr;
+            }
+            return argv[++i];
+        };
+        auto size = [&](const char *name, int64_t &out) -> bool {
+            const char *v = value(name);
+            if (!v)
+                return false;
+            out = parseSize(v);
+            if (out < 0 || out > 0x7FFFFFFF) {
+                std::fprintf(stderr, "cachesim-cli: bad value for %s: %s\n", name, v);
+                return false;
+            }
+            return true;
+        };
+
+        int64_t n = 0;
+        if (arg == "--help" || arg == "-h") {
+            printUsage(stdout);
+            std::exit(0);
+        } else if (arg == "--cache-size") {
+            if (!size("--cache-size", n)) return false;
+            o.cacheSize = int(n);
+        } else if (arg == "--block-size") {
+            if (!size("--block-size", n) || n == 0) return false;
+            o.blockSize = int(n);
+        } else if (arg == "--ways") {
+            if (!size("--ways", n)) return false;
+            o.ways = int(n);
+        } else if (arg == "--policy") {
+            const char *v = value("--policy");
+            if (!v) return false;
+            if (std::strcmp(v, "lru") == 0) {
+                o.policy = CacheEngine::LRU;
+            } else if (std::strcmp(v, "fifo") == 0) {
+                o.policy = CacheEngine::FIFO;
+            } else {
+                std::fprintf(stderr, "cachesim-cli: unknown policy %s\n", v);
+                return false;
+            }
+        } else if (arg == "--index") {
+            const char *v = value("--index");
+            if (!v) return false;
+            if (std::strcmp(v, "modulo") == 0) {
+                o.indexFunction = CacheEngine::Modulo;
+            } else if (std::strcmp(v, "xor") == 0) {
+                o.indexFunction = CacheEngine::XorFold;
+            } else if (std::strcmp(v, "prime") == 0) {
+                o.indexFunction = CacheEngine::PrimeModulo;
+            } else if (std::strcmp(v, "skewed") == 0) {
+                o.indexFunction = CacheEngine::Skewed;
+            } else {
+                std::fprintf(stderr, "cachesim-cli: unknown index function %s\n", v);
+                return false;
+            }
+        } else if (arg == "--victim") {
+            if (!size("--victim", n)) return false;
+            o.victimEntries = int(n);
+        } else if (arg == "--sectors") {
+            if (!size("--sectors", n) || n == 0 || n > 64 || (n & (n - 1)) != 0) {
+                std::fprintf(stderr, "cachesim-cli: --sectors wants a power of two up to 64\n");
+                return false;
+            }
+            o.sectors = int(n);
+        } else if (arg == "--tag-ratio") {
+            if (!size("--tag-ratio", n) || n == 0 || n > 16) {
+                std::fprintf(stderr, "cachesim-cli: --tag-ratio wants 1 to 16\n");
+                return false;
+            }
+            o.tagRatio = int(n);
+        } else if (arg == "--format") {
+            const char *v = value("--format");
+            if (!v) return false;
+            if (std::strcmp(v, "auto") == 0) {
+                o.format = TraceReader::Auto;
+            } else if (std::strcmp(v, "text") == 0) {
+                o.format = TraceReader::Text;
+            } else if (std::strcmp(v, "binary") == 0) {
+                o.format = TraceReader::Binary;
+            } else if (std::strcmp(v, "packed") == 0) {
+                o.format = TraceReader::Packed;
+            } else if (std::strcmp(v, "compressed") == 0) {
+                o.format = TraceReader::Compressed;
+            } else {
+                std::fprintf(stderr, "cachesim-cli: unknown format %s\n", v);
+                return false;
+            }
+        } else if (arg == "--jobs") {
+            if (!size("--jobs", n)) return false;
+            o.jobs = int(n);
+        } else if (arg == "--csv") {
+            o.csv = true;
+        } else if (arg == "--intervals") {
+            if (!size("--intervals", n) || n == 0) return false;
+            o.intervals = int(n);
+        } else if (arg == "--profile") {
+            o.profile = true;
+            o.profileAll = true;
+        } else if (arg == "--no-profile") {
+            o.profile = false;
+            o.profileAll = false;
+        } else if (arg == "--sample-sets") {
+            if (!size("--sample-sets", n) || n == 0) return false;
+            o.sampleSets = int(n);
+        } else if (arg == "--sample-intervals") {
+            const char *v = value("--sample-intervals");
+            long long p = 0, w = 0, u = 0;
+            if (!v || std::sscanf(v, "%lld:%lld:%lld", &p, &w, &u) != 3 || p <= 0 || u <= 0) {
+                std::fprintf(stderr, "cachesim-cli: --sample-intervals wants PERIOD:WARMUP:MEASURE\n");
+                return false;
+            }
+            o.samplePeriod = p;
+            o.sampleWarmup = w;
+            o.sampleMeasure = u;
+        } else if (arg == "--page-size") {
+            const char *v = value("--page-size");
+            if (!v) return false;
+            int64_t bytes = parseSize(v);
+            if (bytes == 4096) {
+                o.mmu.pageSize = Mmu::Page4K;
+            } else if (bytes == 2 * 1024 * 1024) {
+                o.mmu.pageSize = Mmu::Page2M;
+            } else if (bytes == 1024 * 1024 * 1024) {
+                o.mmu.pageSize = Mmu::Page1G;
+            } else {
+                std::fprintf(stderr, "cachesim-cli: page size must be 4K, 2M or 1G\n");
+                return false;
+            }
+            o.translate = true;
+        } else if (arg == "--l1-tlb" || arg == "--l2-tlb") {
+            const char *v = value(arg.c_str());
+            int entries = 0, ways = 0;
+            if (!v || std::sscanf(v, "%d:%d", &entries, &ways) != 2 || entries < 0 || ways < 0
+                || (arg == "--l1-tlb" && entries == 0)) {
+                std::fprintf(stderr, "cachesim-cli: %s wants ENTRIES:WAYS\n", arg.c_str());
+                return false;
+            }
+            (arg == "--l1-tlb" ? o.mmu.l1 : o.mmu.l2) = Mmu::TlbConfig{ entries, ways };
+            o.translate = true;
+        } else if (arg == "--pwc") {
+            if (!size("--pwc", n)) return false;
+            o.mmu.walkCacheEntries = int(n);
+            o.translate = true;
+        } else if (arg == "--indexing") {
+            const char *v = value("--indexing");
+            if (!v) return false;
+            if (std::strcmp(v, "pipt") == 0) {
+                o.mmu.indexing = Mmu::PIPT;
+            } else if (std::strcmp(v, "vipt") == 0) {
+                o.mmu.indexing = Mmu::VIPT;
+            } else {
+                std::fprintf(stderr, "cachesim-cli: unknown indexing %s\n", v);
+                return false;
+            }
+            o.translate = true;
+        } else if (arg == "--timing") {
+            o.timing = true;
+        } else if (arg == "--hit-latency") {
+            if (!size("--hit-latency", n)) return false;
+            o.timingConfig.hitLatency = int(n);
+            o.timing = true;
+        } else if (arg == "--mshrs") {
+            if (!size("--mshrs", n) || n == 0) return false;
+            o.timingConfig.mshrs = int(n);
+            o.timing = true;
+        } else if (arg == "--dram") {
+            const char *v = value("--dram");
+            char row[32] = "";
+            int banks = 0;
+            int64_t rowBytes = -1;
+            if (v && std::sscanf(v, "%d:%31s", &banks, row) == 2)
+                rowBytes = parseSize(row);
+            if (banks <= 0 || rowBytes <= 0 || rowBytes > 0x7FFFFFFF) {
+                std::fprintf(stderr, "cachesim-cli: --dram wants BANKS:ROWSIZE\n");
+                return false;
+            }
+            o.timingConfig.banks = banks;
+            o.timingConfig.rowBytes = int(rowBytes);
+            o.timing = true;
+        } else if (arg == "--dram-latency") {
+            const char *v = value("--dram-latency");
+            int hit = -1, miss = -1;
+            if (!v || std::sscanf(v, "%d:%d", &hit, &miss) != 2 || hit < 0 || miss < hit) {
+                std::fprintf(stderr, "cachesim-cli: --dram-latency wants HIT:MISS cycles, MISS >= HIT\n");
+                return false;
+            }
+            o.timingConfig.rowHitCycles = hit;
+            o.timingConfig.rowMissCycles = miss;
+            o.timing = true;
+        } else if (arg == "--bandwidth") {
+            if (!size("--bandwidth", n) || n == 0) return false;
+            o.timingConfig.busBytesPerCycle = int(n);
+            o.timing = true;
+        } else if (arg == "--clock") {
+            const char *v = value("--clock");
+            if (!v) return false;
+            o.timingConfig.clockGHz = std::atof(v);
+            if (o.timingConfig.clockGHz <= 0) {
+                std::fprintf(stderr, "cachesim-cli: bad value for --clock: %s\n", v);
+                return false;
+            }
+            o.timing = true;
+        } else if (arg == "--load-checkpoint") {
+            const char *v = value("--load-checkpoint");
+            if (!v) return false;
+            o.loadCheckpoint = v;
+        } else if (arg == "--save-checkpoint") {
+            const char *v = value("--save-checkpoint");
+            if (!v) return false;
+            o.saveCheckpoint = v;
+        } else if (arg == "--pack") {
+            const char *v = value("--pack");
+            if (!v) return false;
+            o.pack = v;
+        } else if (arg == "--codec") {
+            const char *v = value("--codec");
+            if (!v) return false;
+            int codec = std::strcmp(v, "zstd") == 0 ? CodecZstd : std::strcmp(v, "lz4") == 0 ? CodecLz4
+                        : std::strcmp(v, "none") == 0 ? CodecNone : -1;
+            if (codec < 0 || !traceCodecAvailable(codec)) {
+                std::fprintf(stderr, "cachesim-cli: codec %s isn't available in this build\n", v);
+                return false;
+            }
+            o.packCodec = TraceCodec(codec);
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            std::fprintf(stderr, "cachesim-cli: unknown option %s\n", arg.c_str());
+            return false;
+        } else {
+            o.traces.push_back(arg);
+        }
+    }
+
+    if (o.traces.empty()) {
+        std::fprintf(stderr, "cachesim-cli: no trace files given\n");
+        return false;
+    }
+    if (!o.loadCheckpoint.empty() && !o.cacheOption.empty()) {
+        std::fprintf(stderr, "cachesim-cli: %s can't be combined with --load-checkpoint, "
+                             "which brings its own cache configuration\n", o.cacheOption.c_str());
+        return false;
+    }
+    if (o.sampleSets > 0 && o.indexFunction == CacheEngine::Skewed) {
+        std::fprintf(stderr, "cachesim-cli: --sample-sets can't sample a skewed cache (no fixed set per block)\n");
+        return false;
+    }
+    if (o.sampleSets > 0 && o.victimEntries > 0) {
+        std::fprintf(stderr, "cachesim-cli: --sample-sets can't sample a victim cache (shared by all sets)\n");
+        return false;
+    }
+    if (o.sectors > o.blockSize) {
+        std::fprintf(stderr, "cachesim-cli: more sectors than bytes in a block\n");
+        return false;
+    }
+    if (o.sampleSets > 0 && o.samplePeriod > 0) {
+        std::fprintf(stderr, "cachesim-cli: pick one of --sample-sets and --sample-intervals\n");
+        return false;
+    }
+    if ((o.intervals > 0 || o.profileAll) && (o.sampleSets > 0 || o.samplePeriod > 0)) {
+        std::fprintf(stderr, "cachesim-cli: --intervals and --profile need a full (unsampled) run\n");
+        return false;
+    }
+    if (o.sampleSets > 0 || o.samplePeriod > 0)
+        o.profile = false;
+    if (o.translate && (o.sampleSets > 0 || o.samplePeriod > 0)) {
+        std::fprintf(stderr, "cachesim-cli: address translation needs a full (unsampled) run\n");
+        return false;
+    }
+    if (o.timing && (o.sampleSets > 0 || o.samplePeriod > 0)) {
+        std::fprintf(stderr, "cachesim-cli: timing needs a full (unsampled) run\n");
+        return false;
+    }
+    if (!o.saveCheckpoint.empty() && o.traces.size() != 1) {
+        std::fprintf(stderr, "cachesim-cli: --save-checkpoint needs exactly one trace\n");
+        return false;
+    }
+    if (!o.pack.empty() && o.traces.size() != 1) {
+        std::fprintf(stderr, "cachesim-cli: --pack needs exactly one trace\n");
+        return false;
+    }
+    return true;
+}
+
+Result simulate(const Options &o, const std::string &path)
+{
+    Result result;
+
+    CacheEngine engine;
+    engine.setStoreData(false);
+    if (!o.loadCheckpoint.empty()) {
+        if (!engine.loadCheckpoint(o.loadCheckpoint, &result.error))
+            return result;
+    } else {
+        engine.setIndexFunction(o.indexFunction);
+        engine.setVictimCache(o.victimEntries);
+        engine.setSectors(o.sectors);
+        engine.setTagRatio(o.tagRatio);
+        engine.configure(o.cacheSize, o.blockSize, o.ways, o.policy);
+    }
+    CacheEngine::Stats before = engine.stats();
+    result.blockSize = engine.blockSize();
+    result.extensions = engine.victimEntries() > 0 || engine.sectors() > 1 || engine.tagRatio() > 1;
+
+    // parseOptions checked these against the command line, which a checkpoint overrides
+    if (o.sampleSets > 0 && (engine.indexFunction() == CacheEngine::Skewed || engine.victimEntries() > 0)) {
+        result.error = "--sample-sets can't sample a skewed cache or a victim cache";
+        return result;
+    }
+
+    TraceReader reader;
+    if (!reader.open(path, o.format, &result.error))
+        return result;
+    std::unique_ptr<TraceContainerWriter> pack;
+    if (!o.pack.empty()) {
+        pack.reset(new TraceContainerWriter);
+        if (!pack->open(o.pack, o.packCodec, &result.error))
+            return result;
+    }
+
+    std::unique_ptr<IntervalStats> intervals;
+    if (o.intervals > 0)
+        intervals.reset(new IntervalStats(o.intervals));
+    std::unique_ptr<SetSampler> setSampler;
+    if (o.sampleSets > 0)
+        setSampler.reset(new SetSampler(engine, o.sampleSets));
+    std::unique_ptr<IntervalSampler> intervalSampler;
+    if (o.samplePeriod > 0)
+        intervalSampler.reset(new IntervalSampler(engine, o.samplePeriod, o.sampleWarmup, o.sampleMeasure));
+    std::unique_ptr<ConflictProfiler> profiler;
+    if (o.profile)
+        profiler.reset(new ConflictProfiler(engine, 16, 4096, o.profileAll ? 1 : PROFILE_SAMPLE));
+    std::unique_ptr<Mmu> mmu;
+    if (o.translate) {
+        mmu.reset(new Mmu(o.mmu));
+        result.synonyms = mmu->hasSynonyms(engine);
+    }
+    std::unique_ptr<TimingModel> timing;
+    if (o.timing) {
+        timing.reset(new TimingModel(o.timingConfig));
+        timing->reset(engine);
+    }
+
+    std::vector<int64_t> chunk(CHUNK);
+    for (;;) {
+        size_t n = reader.read(chunk.data(), chunk.size());
+        if (n == 0)
+            break;
+        result.accesses += int64_t(n);
+        if (pack && !pack->write(chunk.data(), n, &result.error))
+            return result;
+
+        if (setSampler) {
+            for (size_t i = 0; i < n; ++i)
+                setSampler->access(chunk[i]);
+        } else if (intervalSampler) {
+            for (size_t i = 0; i < n; ++i)
+                intervalSampler->access(chunk[i]);
+        } else if (mmu || intervals || profiler || timing) {
+            for (size_t i = 0; i < n; ++i) {
+                CacheEngine::AccessResult r = mmu ? mmu->access(engine, chunk[i]) : engine.access(chunk[i]);
+                if (intervals)
+                    intervals->record(r);
+                if (profiler)
+                    profiler->record(r);
+                if (timing)
+                    timing->record(r);
+            }
+        } else {
+            engine.run(chunk.data(), n);
+        }
+    }
+    if (reader.failed()) {
+        result.error = reader.errorMessage();
+        return result;
+    }
+    result.skippedLines = reader.skippedLines();
+    if (pack && !pack->close(&result.error))
+        return result;
+
+    const CacheEngine::Stats &after = engine.stats();
+    result.stats.hits = after.hits - before.hits;
+    result.stats.misses = after.misses - before.misses;
+    result.stats.evictions = after.evictions - before.evictions;
+    result.stats.victimHits = after.victimHits - before.victimHits;
+    result.stats.sectorMisses = after.sectorMisses - before.sectorMisses;
+    result.stats.fills = after.fills - before.fills;
+    result.stats.bytesFetched = after.bytesFetched - before.bytesFetched;
+
+    if (mmu)
+        result.tlb = mmu->stats();
+    if (timing) {
+        result.timing = timing->stats();
+        result.amat = timing->amat();
+        result.bandwidth = timing->bandwidthGBs();
+    }
+
+    if (setSampler || intervalSampler) {
+        result.sampled = true;
+        result.estimate = setSampler ? setSampler->estimate() : intervalSampler->estimate();
+    }
+
+    if (intervals) {
+        intervals->flush();
+        if (!intervals->samples().empty())
+            result.phases = intervals->samples().back().phase + 1;
+        if (!intervals->exportCsv(path + ".intervals.csv", &result.error))
+            return result;
+    }
+
+    // Only a profile asked for fails the run, e.g. next to a read-only trace
+    if (profiler && !profiler->writeReport(path + ".profile.txt", o.profileAll ? &result.error : &result.profileError)
+        && o.profileAll)
+        return result;
+
+    if (!o.saveCheckpoint.empty() && !engine.saveCheckpoint(o.saveCheckpoint, &result.error))
+        return result;
+
+    result.ok = true;
+    return result;
+}
+
+void printResults(const Options &o, const std::vector<Result> &results)
+{
+    bool sampled = o.sampleSets > 0 || o.samplePeriod > 0;
+    bool phases = o.intervals > 0;
+    bool tlb = o.translate;
+    // From the engines rather than the options, so a loaded checkpoint counts
+    bool extensions = false;
+    for (const Result &r : results)
+        extensions = extensions || (r.ok && r.extensions);
+    bool timing = o.timing;
+
+    if (o.csv) {
+        std::printf("trace,accesses,hits,misses,evictions,miss_rate");
+        if (sampled)
+            std::printf(",simulated,est_miss_rate,ci95_low,ci95_high,est_misses");
+        if (phases)
+            std::printf(",phases");
+        if (extensions)
+            std::printf(",victim_hits,sector_misses,bytes_fetched,bytes_saved");
+        if (timing)
+            std::printf(",cycles,amat,dram_gbs,row_hit_rate,mshr_merges,mshr_stall_cycles");
+        if (tlb)
+            std::printf(",l1_tlb_miss_rate,l2_tlb_miss_rate,page_walks,pte_reads,pte_cache_hits,pwc_accesses,pwc_hits,pages");
+        std::printf("\n");
+    } else {
+        std::printf("%-32s %12s %12s %12s %12s %9s", "trace", "accesses", "hits", "misses", "evictions", "miss%");
+        if (sampled)
+            std::printf(" %12s %9s %19s", "simulated", "est.miss%", "95% interval");
+        if (phases)
+            std::printf(" %7s", "phases");
+        if (extensions)
+            std::printf(" %12s %12s %14s %7s", "victim.hits", "sector.miss", "bytes.fetched", "saved%");
+        if (timing)
+            std::printf(" %14s %8s %8s %8s %12s %12s", "cycles", "amat", "dram.GB/s", "row.hit%", "mshr.merge", "mshr.stall");
+        if (tlb)
+            std::printf(" %9s %9s %10s %10s %9s %10s %9s", "l1tlb.m%", "l2tlb.m%", "walks", "pte.reads", "pte.hit%", "pwc.look", "pwc.hit%");
+        std::printf("\n");
+    }
+
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result &r = results[i];
+        const char *name = o.traces[i].c_str();
+        if (!r.ok)
+            continue;
+
+        int64_t simulated = r.stats.hits + r.stats.misses;
+        double missRate = simulated ? 100.0 * r.stats.misses / simulated : 0.0;
+        const SampleEstimate &e = r.estimate;
+        const Mmu::Stats &t = r.tlb;
+        // L2 TLB miss rate is local: misses over the lookups that reached it
+        double l1TlbMiss = t.translations ? double(t.l1Misses) / t.translations : 0.0;
+        double l2TlbMiss = t.l1Misses ? double(t.l2Misses) / t.l1Misses : 0.0;
+        double pteHit = t.walkReferences ? double(t.walkCacheHits) / t.walkReferences : 0.0;
+        double pwcHit = t.pwcAccesses ? double(t.pwcHits) / t.pwcAccesses : 0.0;
+        // Saved against fetching the whole block on every trip to memory
+        int64_t blockBytes = r.stats.fills * int64_t(r.blockSize);
+        int64_t saved = blockBytes - r.stats.bytesFetched;
+        const TimingModel::Stats &c = r.timing;
+        double rowHit = c.dramReads ? double(c.rowHits) / c.dramReads : 0.0;
+        if (o.csv) {
+            std::printf("%s,%lld,%lld,%lld,%lld,%.6f", name, (long long)r.accesses,
+                        (long long)r.stats.hits, (long long)r.stats.misses,
+                        (long long)r.stats.evictions, missRate / 100.0);
+            if (sampled)
+                std::printf(",%lld,%.6f,%.6f,%.6f,%lld", (long long)e.simulatedAccesses, e.missRate,
+                            e.confidenceLow, e.confidenceHigh, (long long)e.estimatedMisses);
+            if (phases)
+                std::printf(",%d", r.phases);
+            if (extensions)
+                std::printf(",%lld,%lld,%lld,%lld", (long long)r.stats.victimHits, (long long)r.stats.sectorMisses,
+                            (long long)r.stats.bytesFetched, (long long)saved);
+            if (timing)
+                std::printf(",%lld,%.3f,%.3f,%.6f,%lld,%lld", (long long)c.cycles, r.amat, r.bandwidth, rowHit,
+                            (long long)c.mshrMerges, (long long)c.mshrStallCycles);
+            if (tlb)
+                std::printf(",%.6f,%.6f,%lld,%lld,%lld,%lld,%lld,%lld", l1TlbMiss, l2TlbMiss,
+                            (long long)t.l2Misses, (long long)t.walkReferences, (long long)t.walkCacheHits,
+                            (long long)t.pwcAccesses, (long long)t.pwcHits, (long long)t.pagesMapped);
+            std::printf("\n");
+        } else {
+            std::printf("%-32s %12lld %12lld %12lld %12lld %8.3f%%", name, (long long)r.accesses,
+                        (long long)r.stats.hits, (long long)r.stats.misses,
+                        (long long)r.stats.evictions, missRate);
+            if (sampled)
+                std::printf(" %12lld %8.3f%% [%7.3f%%, %7.3f%%]", (long long)e.simulatedAccesses,
+                            100.0 * e.missRate, 100.0 * e.confidenceLow, 100.0 * e.confidenceHigh);
+            if (phases)
+                std::printf(" %7d", r.phases);
+            if (extensions)
+                std::printf(" %12lld %12lld %14lld %6.2f%%", (long long)r.stats.victimHits,
+                            (long long)r.stats.sectorMisses, (long long)r.stats.bytesFetched,
+                            blockBytes ? 100.0 * saved / blockBytes : 0.0);
+            if (timing)
+                std::printf(" %14lld %8.2f %9.2f %7.2f%% %12lld %12lld", (long long)c.cycles, r.amat, r.bandwidth,
+                            100.0 * rowHit, (long long)c.mshrMerges, (long long)c.mshrStallCycles);
+            if (tlb)
+                std::printf(" %8.3f%% %8.3f%% %10lld %10lld %8.3f%% %10lld %8.3f%%", 100.0 * l1TlbMiss,
+                            100.0 * l2TlbMiss, (long long)t.l2Misses, (long long)t.walkReferences,
+                            100.0 * pteHit, (long long)t.pwcAccesses, 100.0 * pwcHit);
+            std::printf("\n");
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(stderr);
+        return 1;
+    }
+
+    // One engine per trace; workers take the next trace until none are left
+    std::vector<Result> results(options.traces.size());
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < options.traces.size(); i = next++)
+            results[i] = simulate(options, options.traces[i]);
+    };
+
+    unsigned jobs = options.jobs > 0 ? unsigned(options.jobs) : std::thread::hardware_concurrency();
+    jobs = std::max(1u, std::min(jobs, unsigned(options.traces.size())));
+    std::vector<std::thread> threads;
+    for (unsigned t = 1; t < jobs; ++t)
+        threads.emplace_back(worker);
+    worker();
+    for (std::thread &t : threads)
+        t.join();
+
+    printResults(options, results);
+
+    int status = 0;
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (!results[i].ok) {
+            std::fprintf(stderr, "cachesim-cli: %s: %s\n", options.traces[i].c_str(), results[i].error.c_str());
+            status = 2;
+        } else if (results[i].synonyms) {
+            std::fprintf(stderr, "cachesim-cli: %s: VIPT set index uses bits above the page offset, "
+                                 "so the same block can be cached twice (synonyms)\n",
+                         options.traces[i].c_str());
+        }
+        if (results[i].ok && !results[i].profileError.empty()) {
+            std::fprintf(stderr, "cachesim-cli: %s: no profile: %s\n",
+                         options.traces[i].c_str(), results[i].profileError.c_str());
+        }
+        if (results[i].ok && results[i].skippedLines > 0) {
+            std::fprintf(stderr, "cachesim-cli: %s: skipped %zu lines that aren't \"Read Byte N\"\n",
+                         options.traces[i].c_str(), results[i].skippedLines);
+        }
+    }
+    return status;
+}
@@ -0,0 +1,219 @@
+#ifndef CACHETRACE_H
+#define CACHETRACE_H
+
+// Compiled-in trace capture: include this header in your own program, mark
+// the memory reads you care about, and run it with CACHESIM_TRACE=out.ctr
+// (or through cachesim-capture). The trace can go straight into
+// cachesim-cli.
+//
+//     #include "CacheTrace.h"
+//     for (size_t i = 0; i < n; ++i) {
+//         CACHESIM_TRACE_READ(&a[i]);
+//         sum += a[i];
+//     }
+//
+// Without CACHESIM_TRACE in the environment a marked read costs one
+// predictable branch; define CACHESIM_TRACE_DISABLE to compile them out.
+// Header only, so it can be copied into any project.
+//
+// Each thread buffers its addresses and hands them to the file in batches,
+// so threads only take the lock once per batch. Batches of different
+// threads are interleaved in the file the way they were flushed. A thread's
+// batch goes out when the thread ends; the file is closed at exit, so a
+// thread still running then loses its last batch unless it calls
+// CACHESIM_TRACE_FLUSH() first.
+//
+// File format (*.ctr): the 8 bytes "CSIMTRC1", then one record per access:
+// the difference to the previous address, zigzag-encoded, as a LEB128
+// varint. Loops over arrays mostly need one byte per access instead of 8.
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+
+namespace cachesim {
+
+const char TRACE_MAGIC[8] = { 'C', 'S', 'I', 'M', 'T', 'R', 'C', '1' };
+const size_t TRACE_MAX_VARINT = 10;
+
+inline uint64_t zigzag(int64_t value)
+{
+    return (uint64_t(value) << 1) ^ uint64_t(value >> 63);
+}
+
+inline int64_t unzigzag(uint64_t value)
+{
+    return int64_t(value >> 1) ^ -int64_t(value & 1);
+}
+
+// Appends value to out, returns the bytes written (1 to 10)
+inline size_t putVarint(uint8_t *out, uint64_t value)
+{
+    size_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = uint8_t(value) | 0x80;
+        value >>= 7;
+    }
+    out[n++] = uint8_t(value);
+    return n;
+}
+
+// Delta + zigzag + varint encoding of addresses[0..count), continuing from
+// previous. out needs count * TRACE_MAX_VARINT bytes; returns bytes used.
+inline size_t encodeAddresses(const int64_t *addresses, size_t count, int64_t &previous, uint8_t *out)
+{
+    size_t n = 0;
+    for (size_t i = 0; i < count; ++i) {
+        n += putVarint(out + n, zigzag(int64_t(uint64_t(addresses[i]) - uint64_t(previous))));
+        previous = addresses[i];
+    }
+    return n;
+}
+
+namespace detail {
+
+// The one output file of the process. Never destroyed: threads may still
+// flush into it during static destruction, so the mutex has to outlive
+// them; the file itself is closed by an atexit handler.
+class TraceSink
+{
+public:
+    static TraceSink &instance()
+    {
+        static TraceSink *sink = new TraceSink;
+        return *sink;
+    }
+
+    bool enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+    void write(const int64_t *addresses, size_t count)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_file)
+            return;
+        size_t bytes = encodeAddresses(addresses, count, m_previous, m_encoded);
+        if (std::fwrite(m_encoded, 1, bytes, m_file) != bytes) {
+            // Disk full or similar: stop tracing rather than write garbage
+            std::fprintf(stderr, "CacheTrace: write failed, tracing stopped\n");
+            std::fclose(m_file);
+            m_file = nullptr;
+            m_enabled.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    void flush()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_file)
+            std::fflush(m_file);
+    }
+
+    static const size_t BATCH = 8192;   // addresses per thread buffer
+
+private:
+    TraceSink()
+    {
+        const char *path = std::getenv("CACHESIM_TRACE");
+        if (!path || !*path)
+            return;
+        m_file = std::fopen(path, "wb");
+        if (!m_file) {
+            std::fprintf(stderr, "CacheTrace: cannot open %s for writing\n", path);
+            return;
+        }
+        std::setvbuf(m_file, nullptr, _IOFBF, 1 << 20);
+        std::fwrite(TRACE_MAGIC, 1, sizeof(TRACE_MAGIC), m_file);
+        m_enabled.store(true, std::memory_order_relaxed);
+        // The thread calling exit() destroys its thread_locals first, so
+        // the main thread's batch is in before this runs
+        std::atexit(close);
+    }
+
+    // Later writes find no file and are dropped
+    static void close()
+    {
+        TraceSink &sink = instance();
+        std::lock_guard<std::mutex> lock(sink.m_mutex);
+        sink.m_enabled.store(false, std::memory_order_relaxed);
+        if (sink.m_file)
+            std::fclose(sink.m_file);
+        sink.m_file = nullptr;
+    }
+
+    std::mutex m_mutex;
+    std::FILE *m_file = nullptr;
+    std::atomic<bool> m_enabled{ false };
+    int64_t m_previous = 0;
+    uint8_t m_encoded[BATCH * TRACE_MAX_VARINT];
+};
+
+// Per-thread batch, handed to the sink when full and when the thread ends
+class TraceBuffer
+{
+public:
+    TraceBuffer()
+        : m_sink(TraceSink::instance())
+    {
+    }
+
+    ~TraceBuffer() { flush(); }
+
+    void add(int64_t address)
+    {
+        m_addresses[m_count++] = address;
+        if (m_count == TraceSink::BATCH)
+            flush();
+    }
+
+    void flush()
+    {
+        if (m_count)
+            m_sink.write(m_addresses, m_count);
+        m_count = 0;
+    }
+
+private:
+    TraceSink &m_sink;
+    size_t m_count = 0;
+    int64_t m_addresses[TraceSink::BATCH];
+};
+
+inline TraceBuffer &threadBuffer()
+{
+    thread_local TraceBuffer buffer;
+    return buffer;
+}
+
+} // namespace detail
+
+// Record a read of the byte at address
+inline void traceRead(const void *address)
+{
+    static detail::TraceSink &sink = detail::TraceSink::instance();
+    if (sink.enabled())
+        detail::threadBuffer().add(int64_t(reinterpret_cast<uintptr_t>(address)));
+}
+
+// Push this thread's batch and the file buffer out, e.g. before a fork
+// or when the program may be killed rather than exit normally
+inline void traceFlush()
+{
+    if (!detail::TraceSink::instance().enabled())
+        return;
+    detail::threadBuffer().flush();
+    detail::TraceSink::instance().flush();
+}
+
+} // namespace cachesim
+
+#ifdef CACHESIM_TRACE_DISABLE
+#define CACHESIM_TRACE_READ(address) ((void)0)
+#define CACHESIM_TRACE_FLUSH() ((void)0)
+#else
+#define CACHESIM_TRACE_READ(address) ::cachesim::traceRead(address)
+#define CACHESIM_TRACE_FLUSH() ::cachesim::traceFlush()
+#endif
+
+#endif // CACHETRACE_H
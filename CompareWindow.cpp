@@ -0,0 +1,236 @@
+#include "CompareWindow.h"
+#include "ui_CompareWindow.h"
+
+#include <QFileDialog>
+#include <QGraphicsRectItem>
+#include <QGraphicsTextItem>
+#include <QMessageBox>
+#include <QPen>
+
+#include <algorithm>
+
+namespace {
+
+// One colour per configuration, in pin order
+const Qt::GlobalColor CONFIG_COLORS[ConfigComparison::MAX_CONFIGS] = {
+    Qt::red, Qt::blue, Qt::darkGreen, Qt::magenta, Qt::darkCyan, Qt::darkYellow, Qt::black, Qt::gray
+};
+
+const int CHART_WIDTH = 720;
+const int CHART_HEIGHT = 200;
+const int MAX_DIFFERENCES = 120;   // columns in the per-access strip
+const int CELL = 12;
+
+QColor outcomeColor(int outcome)
+{
+    switch (outcome) {
+    case ConfigComparison::Hit: return QColor(Qt::green);
+    case ConfigComparison::VictimHit: return QColor(255, 165, 0);
+    case ConfigComparison::SectorMiss: return QColor(Qt::yellow);
+    default: return QColor(Qt::red);
+    }
+}
+
+} // namespace
+
+CompareWindow::CompareWindow(const ConfigComparison &comparison, const QVector<int> &accessLines, int currentLine,
+                             QWidget *parent) :
+    QDialog(parent),
+    ui(new Ui::CompareWindow),
+    scene(new QGraphicsScene(this)),
+    comparison(comparison),
+    accessLines(accessLines)
+{
+    ui->setupUi(this);
+    ui->graphicsView->setScene(scene);
+
+    drawComparison();
+    setCurrentLine(currentLine);
+}
+
+CompareWindow::~CompareWindow()
+{
+    delete ui;
+}
+
+void CompareWindow::setCurrentLine(int line)
+{
+    // Invalid lines aren't compared, so count the accesses before this line
+    currentAccess = int(std::lower_bound(accessLines.begin(), accessLines.end(), line) - accessLines.begin());
+    placeMarker();
+}
+
+void CompareWindow::drawComparison()
+{
+    scene->clear();
+    marker = nullptr;
+    markerLabel = nullptr;
+
+    if (comparison.accesses() == 0) {
+        scene->addText("No valid instructions in the editor to compare on.");
+        return;
+    }
+
+    int y = drawSummary(0);
+    y = drawMissRateCurves(y + 30);
+    y = drawDifferences(y + 30);
+
+    scene->setSceneRect(-60, -20, CHART_WIDTH + 120, y + 40);
+}
+
+// One line per configuration: colour, description and totals
+int CompareWindow::drawSummary(int y)
+{
+    QGraphicsTextItem *title = scene->addText(QString("%1 instructions through %2 configurations")
+                                                  .arg(qulonglong(comparison.accesses())).arg(comparison.configCount()));
+    title->setPos(0, y);
+    y += 25;
+
+    for (int i = 0; i < comparison.configCount(); ++i) {
+        const ConfigComparison::Result &result = comparison.result(i);
+        int64_t accesses = result.stats.hits + result.stats.misses;
+        QColor color(CONFIG_COLORS[i]);
+
+        scene->addRect(0, y + 6, 12, 12, QPen(color), QBrush(color));
+        QString line = QString("%1:  %2 hits, %3 misses, miss rate %4%, AMAT %5 cycles")
+                           .arg(QString::fromStdString(ConfigComparison::describe(comparison.config(i))))
+                           .arg(result.stats.hits)
+                           .arg(result.stats.misses)
+                           .arg(accesses ? 100.0 * result.stats.misses / accesses : 0.0, 0, 'f', 1)
+                           .arg(result.amat, 0, 'f', 1);
+        if (result.stats.victimHits > 0)
+            line += QString(" (%1 misses saved by the victim cache)").arg(result.stats.victimHits);
+        QGraphicsTextItem *text = scene->addText(line);
+        text->setDefaultTextColor(color);
+        text->setPos(18, y);
+        y += 20;
+    }
+    return y;
+}
+
+// Miss rate so far after every access, one line per configuration
+int CompareWindow::drawMissRateCurves(int y)
+{
+    QPen axisPen(Qt::black);
+    axisPen.setWidth(1);
+
+    scene->addLine(0, y, 0, y + CHART_HEIGHT, axisPen);
+    scene->addLine(0, y + CHART_HEIGHT, CHART_WIDTH, y + CHART_HEIGHT, axisPen);
+    QGraphicsTextItem *top = scene->addText("100%");
+    top->setPos(-45, y - 10);
+    QGraphicsTextItem *bottom = scene->addText("0%");
+    bottom->setPos(-30, y + CHART_HEIGHT - 10);
+
+    size_t points = comparison.accesses() < size_t(CHART_WIDTH / 2) ? comparison.accesses() : size_t(CHART_WIDTH / 2);
+    for (int i = 0; i < comparison.configCount(); ++i) {
+        QPen pen(CONFIG_COLORS[i]);
+        pen.setWidth(2);
+        std::vector<double> curve = comparison.missRateCurve(i, points);
+        QPointF previous;
+        for (size_t p = 0; p < curve.size(); ++p) {
+            QPointF point(CHART_WIDTH * double(p + 1) / double(curve.size()), y + CHART_HEIGHT * (1.0 - curve[p]));
+            if (p > 0)
+                scene->addLine(QLineF(previous, point), pen);
+            previous = point;
+        }
+    }
+
+    // Where the step-by-step view is now, moved by setCurrentLine
+    QPen nowPen(Qt::black);
+    nowPen.setStyle(Qt::DashLine);
+    curvesTop = y;
+    marker = scene->addLine(0, y, 0, y + CHART_HEIGHT, nowPen);
+    markerLabel = scene->addText(QString());
+    markerLabel->setScale(0.8);
+
+    QGraphicsTextItem *end = scene->addText(QString::number(qulonglong(comparison.accesses())));
+    end->setScale(0.7);
+    end->setPos(CHART_WIDTH - 20, y + CHART_HEIGHT + 4);
+    QGraphicsTextItem *caption = scene->addText("Miss rate so far, after each instruction");
+    caption->setPos(0, y + CHART_HEIGHT + 20);
+    return y + CHART_HEIGHT + 45;
+}
+
+void CompareWindow::placeMarker()
+{
+    if (!marker)
+        return;
+    bool visible = currentAccess > 0 && size_t(currentAccess) <= comparison.accesses();
+    marker->setVisible(visible);
+    markerLabel->setVisible(visible);
+    if (!visible)
+        return;
+
+    double x = CHART_WIDTH * double(currentAccess) / double(comparison.accesses());
+    marker->setLine(x, curvesTop, x, curvesTop + CHART_HEIGHT);
+    markerLabel->setPlainText(QString("you are here (%1)").arg(currentAccess));
+    markerLabel->setPos(x + 2, curvesTop - 20);
+}
+
+// Outcome of every configuration on the accesses where they disagree
+int CompareWindow::drawDifferences(int y)
+{
+    std::vector<size_t> columns;
+    size_t total = 0;
+    for (size_t a = 0; a < comparison.accesses(); ++a) {
+        if (comparison.differs(a)) {
+            if (columns.size() < size_t(MAX_DIFFERENCES))
+                columns.push_back(a);
+            total++;
+        }
+    }
+
+    QString heading = total == 0
+        ? QString("All configurations hit, miss and evict exactly the same on every instruction.")
+        : QString("Instructions where the configurations disagree: %1 of %2%3 (green = hit, red = miss, "
+                  "orange = victim cache hit, yellow = sector miss, dot = evicted a block)")
+              .arg(qulonglong(total)).arg(qulonglong(comparison.accesses()))
+              .arg(total > columns.size() ? QString(", first %1 shown").arg(qulonglong(columns.size())) : QString());
+    QGraphicsTextItem *title = scene->addText(heading);
+    title->setPos(0, y);
+    y += 30;
+    if (columns.empty())
+        return y;
+
+    // Instruction number over every tenth column
+    for (size_t c = 0; c < columns.size(); c += 10) {
+        QGraphicsTextItem *number = scene->addText(QString::number(qulonglong(columns[c] + 1)));
+        number->setScale(0.7);
+        number->setPos(c * CELL, y);
+    }
+    y += 18;
+
+    QPen gridPen(Qt::lightGray);
+    for (int i = 0; i < comparison.configCount(); ++i) {
+        const std::vector<uint8_t> &outcomes = comparison.result(i).outcomes;
+        const std::vector<int64_t> &evicted = comparison.result(i).evicted;
+        QGraphicsRectItem *swatch = scene->addRect(-20, y + 1, CELL - 2, CELL - 2, QPen(CONFIG_COLORS[i]),
+                                                   QBrush(CONFIG_COLORS[i]));
+        swatch->setToolTip(QString::fromStdString(ConfigComparison::describe(comparison.config(i))));
+        for (size_t c = 0; c < columns.size(); ++c) {
+            uint8_t outcome = outcomes[columns[c]];
+            QGraphicsRectItem *cell = scene->addRect(c * CELL, y, CELL, CELL, gridPen, QBrush(outcomeColor(outcome)));
+            QString tip = QString("Instruction %1: Read Byte %2, %3")
+                              .arg(qulonglong(columns[c] + 1)).arg(comparison.address(columns[c]))
+                              .arg(ConfigComparison::outcomeName(outcome));
+            if (evicted[columns[c]] >= 0) {
+                scene->addRect(c * CELL + CELL / 2 - 2, y + CELL / 2 - 2, 4, 4, QPen(Qt::black), QBrush(Qt::black));
+                tip += QString(", evicted the block at %1").arg(qlonglong(evicted[columns[c]]));
+            }
+            cell->setToolTip(tip);
+        }
+        y += CELL;
+    }
+    return y;
+}
+
+void CompareWindow::on_exportButton_clicked()
+{
+    QString path = QFileDialog::getSaveFileName(this, "Export Comparison", QString(), "CSV files (*.csv)");
+    if (path.isEmpty())
+        return;
+
+    std::string error;
+    if (!comparison.exportCsv(path.toStdString(), &error))
+        QMessageBox::warning(this, "Export Comparison", QString::fromStdString(error));
+}
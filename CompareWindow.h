@@ -0,0 +1,51 @@
+#ifndef COMPAREWINDOW_H
+#define COMPAREWINDOW_H
+
+#include <QDialog>
+#include <QGraphicsLineItem>
+#include <QGraphicsScene>
+#include <QGraphicsTextItem>
+#include <QVector>
+
+#include "ConfigComparison.h"
+
+namespace Ui {
+class CompareWindow;
+}
+
+class CompareWindow : public QDialog
+{
+    Q_OBJECT
+
+public:
+    // accessLines: the editor line of every compared access, in order.
+    // currentLine: the next line Next Step will run, marked on the curves.
+    CompareWindow(const ConfigComparison &comparison, const QVector<int> &accessLines, int currentLine,
+                  QWidget *parent = nullptr);
+    ~CompareWindow();
+
+public slots:
+    // Moves the "you are here" marker as the main window steps
+    void setCurrentLine(int line);
+
+private slots:
+    void on_exportButton_clicked();
+
+private:
+    Ui::CompareWindow *ui;
+    QGraphicsScene *scene;
+    ConfigComparison comparison;   // own copy, already run
+    QVector<int> accessLines;
+    int currentAccess = 0;         // accesses before the current line
+    int curvesTop = 0;
+    QGraphicsLineItem *marker = nullptr;
+    QGraphicsTextItem *markerLabel = nullptr;
+
+    void drawComparison();
+    int drawSummary(int y);
+    int drawMissRateCurves(int y);
+    int drawDifferences(int y);
+    void placeMarker();
+};
+
+#endif // COMPAREWINDOW_H
@@ -0,0 +1,152 @@
+#include "ConfigComparison.h"
+
+#include <cstdio>
+#include <thread>
+
+bool ConfigComparison::addConfig(const Config &config)
+{
+    if (int(m_configs.size()) >= MAX_CONFIGS)
+        return false;
+    m_configs.push_back(config);
+    // Results of an earlier run don't cover the new one
+    m_addresses.clear();
+    m_results.clear();
+    return true;
+}
+
+void ConfigComparison::clear()
+{
+    m_configs.clear();
+    m_addresses.clear();
+    m_results.clear();
+}
+
+std::string ConfigComparison::describe(const Config &config)
+{
+    std::string text = std::to_string(config.cacheSize) + "B, " + std::to_string(config.blockSize) + "B blocks, ";
+    if (config.associativity == 0)
+        text += "fully assoc.";
+    else if (config.associativity == 1)
+        text += "direct";
+    else
+        text += std::to_string(config.associativity) + "-way";
+    text += config.policy == CacheEngine::FIFO ? ", FIFO" : ", LRU";
+
+    switch (config.indexFunction) {
+    case CacheEngine::XorFold: text += ", XOR index"; break;
+    case CacheEngine::PrimeModulo: text += ", prime index"; break;
+    case CacheEngine::Skewed: text += ", skewed"; break;
+    default: break;
+    }
+    if (config.victimEntries > 0)
+        text += ", " + std::to_string(config.victimEntries) + " victim";
+    return text;
+}
+
+void ConfigComparison::run(const int64_t *addresses, size_t count)
+{
+    m_addresses.assign(addresses, addresses + count);
+    m_results.assign(m_configs.size(), Result());
+
+    // Every configuration only touches its own engine and result
+    auto simulate = [this](size_t i) {
+        const Config &config = m_configs[i];
+        CacheEngine engine;
+        engine.setStoreData(false);
+        engine.setIndexFunction(config.indexFunction);
+        engine.setVictimCache(config.victimEntries);
+        engine.configure(config.cacheSize, config.blockSize, config.associativity, config.policy);
+        TimingModel timing;
+        timing.reset(engine);
+
+        Result &result = m_results[i];
+        result.outcomes.resize(m_addresses.size());
+        result.evicted.resize(m_addresses.size());
+        for (size_t a = 0; a < m_addresses.size(); ++a) {
+            CacheEngine::AccessResult r = engine.access(m_addresses[a]);
+            timing.record(r);
+            result.outcomes[a] = r.hit ? Hit : r.victimHit ? VictimHit : r.sectorMiss ? SectorMiss : Miss;
+            // Byte addresses, so configurations with different block sizes line up
+            result.evicted[a] = r.evicted ? r.evictedBlock * config.blockSize : -1;
+        }
+        result.stats = engine.stats();
+        result.amat = timing.amat();
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < m_configs.size(); ++i)
+        workers.emplace_back(simulate, i);
+    if (!m_configs.empty())
+        simulate(0);
+    for (std::thread &t : workers)
+        t.join();
+}
+
+bool ConfigComparison::differs(size_t access) const
+{
+    for (size_t i = 1; i < m_results.size(); ++i) {
+        if (m_results[i].outcomes[access] != m_results[0].outcomes[access]
+            || m_results[i].evicted[access] != m_results[0].evicted[access])
+            return true;
+    }
+    return false;
+}
+
+const char *ConfigComparison::outcomeName(int outcome)
+{
+    static const char *const names[] = { "miss", "hit", "victim", "sector" };
+    return outcome >= Miss && outcome <= SectorMiss ? names[outcome] : "?";
+}
+
+std::vector<double> ConfigComparison::missRateCurve(int config, size_t points) const
+{
+    std::vector<double> curve;
+    const std::vector<uint8_t> &outcomes = m_results[size_t(config)].outcomes;
+    if (outcomes.empty() || points == 0)
+        return curve;
+    if (points > outcomes.size())
+        points = outcomes.size();
+
+    curve.reserve(points);
+    int64_t misses = 0;
+    size_t done = 0;
+    for (size_t p = 1; p <= points; ++p) {
+        size_t end = outcomes.size() * p / points;
+        for (; done < end; ++done)
+            misses += outcomes[done] != Hit;
+        curve.push_back(double(misses) / double(end));
+    }
+    return curve;
+}
+
+bool ConfigComparison::exportCsv(const std::string &path, std::string *error) const
+{
+    FILE *f = std::fopen(path.c_str(), "w");
+    if (!f) {
+        if (error)
+            *error = "cannot open " + path + " for writing";
+        return false;
+    }
+
+    std::fprintf(f, "access,address");
+    for (const Config &config : m_configs)
+        std::fprintf(f, ",\"%s\",\"%s evicted\"", describe(config).c_str(), describe(config).c_str());
+    std::fprintf(f, "\n");
+
+    for (size_t a = 0; a < m_addresses.size(); ++a) {
+        std::fprintf(f, "%zu,%lld", a + 1, static_cast<long long>(m_addresses[a]));
+        for (const Result &result : m_results) {
+            std::fprintf(f, ",%s,", outcomeName(result.outcomes[a]));
+            if (result.evicted[a] >= 0)
+                std::fprintf(f, "%lld", static_cast<long long>(result.evicted[a]));
+        }
+        std::fprintf(f, "\n");
+    }
+
+    if (std::fclose(f) != 0) {
+        if (error)
+            *error = "short write to " + path;
+        return false;
+    }
+    return true;
+}
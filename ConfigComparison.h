@@ -0,0 +1,78 @@
+#ifndef CONFIGCOMPARISON_H
+#define CONFIGCOMPARISON_H
+
+#include "CacheEngine.h"
+#include "TimingModel.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Runs one address stream through several cache configurations, one engine
+// per worker thread, and keeps the outcome of every access for each of them
+// so they can be lined up access by access afterwards.
+class ConfigComparison
+{
+public:
+    static const int MAX_CONFIGS = 8;
+
+    struct Config {
+        int cacheSize = 64;
+        int blockSize = 16;
+        int associativity = 1;       // 0 = fully associative
+        int policy = CacheEngine::LRU;
+        int indexFunction = CacheEngine::Modulo;
+        int victimEntries = 0;
+    };
+
+    // Per access
+    enum Outcome : uint8_t {
+        Miss = 0,
+        Hit = 1,
+        VictimHit = 2,  // missed the cache, found in the victim cache
+        SectorMiss = 3  // the tag was there, the sector wasn't (sectored lines only)
+    };
+
+    struct Result {
+        CacheEngine::Stats stats;
+        double amat;                 // cycles, default TimingModel settings
+        std::vector<uint8_t> outcomes;
+        std::vector<int64_t> evicted;   // per access: first byte of the block it evicted, -1 = none
+    };
+
+    // False (and nothing added) when there are MAX_CONFIGS already.
+    // Drops the results of an earlier run.
+    bool addConfig(const Config &config);
+    void clear();
+
+    int configCount() const { return int(m_configs.size()); }
+    const Config &config(int i) const { return m_configs[size_t(i)]; }
+    // "64B, 16B blocks, 2-way, LRU" plus index function and victim cache if set
+    static std::string describe(const Config &config);
+    // "miss", "hit", "victim" or "sector"
+    static const char *outcomeName(int outcome);
+
+    // Simulates addresses[0..count) with every configuration from a cold cache
+    void run(const int64_t *addresses, size_t count);
+
+    size_t accesses() const { return m_addresses.size(); }
+    int64_t address(size_t i) const { return m_addresses[i]; }
+    const Result &result(int config) const { return m_results[size_t(config)]; }
+
+    // Whether the configurations didn't all do the same on access i: same
+    // outcome and, if they evicted something, the same bytes
+    bool differs(size_t access) const;
+    // Misses / accesses after each of `points` evenly spaced accesses
+    std::vector<double> missRateCurve(int config, size_t points) const;
+
+    // access,address and per configuration the outcome (hit/miss/victim/sector)
+    // and the address of the block it evicted (empty if none)
+    bool exportCsv(const std::string &path, std::string *error = nullptr) const;
+
+private:
+    std::vector<Config> m_configs;
+    std::vector<int64_t> m_addresses;
+    std::vector<Result> m_results;
+};
+
+#endif // CONFIGCOMPARISON_H
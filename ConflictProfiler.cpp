@@ -0,0 +1,343 @@
+#include "ConflictProfiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <numeric>
+
+namespace {
+
+uint64_t hashKey(int64_t a, int64_t b, int set)
+{
+    // splitmix64 finaliser over the three parts
+    uint64_t x = uint64_t(a) * 0x9E3779B97F4A7C15ull ^ uint64_t(b) * 0xC2B2AE3D27D4EB4Full ^ uint64_t(uint32_t(set));
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ull;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBull;
+    x ^= x >> 31;
+    return x;
+}
+
+void appendf(std::string &out, const char *format, ...)
+{
+    char line[256];
+    va_list args;
+    va_start(args, format);
+    int n = std::vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (n > 0)
+        out.append(line, size_t(n) < sizeof(line) ? size_t(n) : sizeof(line) - 1);
+}
+
+} // namespace
+
+HeavyHitters::HeavyHitters(int k)
+    : m_k(k > 0 ? k : 1)
+    , m_sketch(size_t(SKETCH_DEPTH) * SKETCH_WIDTH, 0)
+{
+    size_t slots = 1;
+    while (slots < size_t(m_k) * 4)
+        slots <<= 1;
+    m_index.assign(slots, -1);
+    m_items.reserve(size_t(m_k));
+    m_heap.reserve(size_t(m_k));
+    m_heapPos.reserve(size_t(m_k));
+}
+
+int HeavyHitters::find(uint64_t hash, int64_t a, int64_t b, int set) const
+{
+    size_t mask = m_index.size() - 1;
+    for (size_t slot = size_t(hash >> 32) & mask;; slot = (slot + 1) & mask) {
+        int i = m_index[slot];
+        if (i < 0)
+            return -1;
+        const Item &item = m_items[size_t(i)];
+        if (item.a == a && item.b == b && item.set == set)
+            return i;
+    }
+}
+
+void HeavyHitters::insertIndex(int item)
+{
+    size_t mask = m_index.size() - 1;
+    size_t slot = size_t(m_hashes[size_t(item)] >> 32) & mask;
+    while (m_index[slot] >= 0)
+        slot = (slot + 1) & mask;
+    m_index[slot] = item;
+}
+
+void HeavyHitters::eraseIndex(int item)
+{
+    size_t mask = m_index.size() - 1;
+    size_t hole = size_t(m_hashes[size_t(item)] >> 32) & mask;
+    while (m_index[hole] != item)
+        hole = (hole + 1) & mask;
+
+    // Backward-shift deletion, so lookups never need tombstones
+    for (size_t next = (hole + 1) & mask; m_index[next] >= 0; next = (next + 1) & mask) {
+        size_t home = size_t(m_hashes[size_t(m_index[next])] >> 32) & mask;
+        bool between = hole <= next ? (hole < home && home <= next) : (hole < home || home <= next);
+        if (!between) {
+            m_index[hole] = m_index[next];
+            hole = next;
+        }
+    }
+    m_index[hole] = -1;
+}
+
+void HeavyHitters::siftUp(int pos)
+{
+    int item = m_heap[size_t(pos)];
+    while (pos > 0) {
+        int parent = (pos - 1) / 2;
+        if (m_items[size_t(m_heap[size_t(parent)])].count <= m_items[size_t(item)].count)
+            break;
+        m_heap[size_t(pos)] = m_heap[size_t(parent)];
+        m_heapPos[size_t(m_heap[size_t(pos)])] = pos;
+        pos = parent;
+    }
+    m_heap[size_t(pos)] = item;
+    m_heapPos[size_t(item)] = pos;
+}
+
+void HeavyHitters::siftDown(int pos)
+{
+    const int size = int(m_heap.size());
+    int item = m_heap[size_t(pos)];
+    for (;;) {
+        int child = 2 * pos + 1;
+        if (child >= size)
+            break;
+        if (child + 1 < size && m_items[size_t(m_heap[size_t(child + 1)])].count < m_items[size_t(m_heap[size_t(child)])].count)
+            child++;
+        if (m_items[size_t(item)].count <= m_items[size_t(m_heap[size_t(child)])].count)
+            break;
+        m_heap[size_t(pos)] = m_heap[size_t(child)];
+        m_heapPos[size_t(m_heap[size_t(pos)])] = pos;
+        pos = child;
+    }
+    m_heap[size_t(pos)] = item;
+    m_heapPos[size_t(item)] = pos;
+}
+
+void HeavyHitters::add(int64_t a, int64_t b, int set)
+{
+    uint64_t hash = hashKey(a, b, set);
+    m_total++;
+
+    // Conservative update: only raise the counters that hold the minimum,
+    // which keeps the estimate an upper bound but a much tighter one
+    uint64_t *cells[SKETCH_DEPTH];
+    uint64_t estimate = UINT64_MAX;
+    for (int row = 0; row < SKETCH_DEPTH; ++row) {
+        size_t column = size_t(hash >> (row * 10)) & (SKETCH_WIDTH - 1);
+        cells[row] = &m_sketch[size_t(row) * SKETCH_WIDTH + column];
+        estimate = std::min(estimate, *cells[row]);
+    }
+    estimate++;
+    for (int row = 0; row < SKETCH_DEPTH; ++row) {
+        if (*cells[row] < estimate)
+            *cells[row] = estimate;
+    }
+
+    // Counts only grow, so a kept item can only move down the min-heap
+    int i = find(hash, a, b, set);
+    if (i >= 0) {
+        m_items[size_t(i)].count = int64_t(estimate);
+        siftDown(m_heapPos[size_t(i)]);
+        return;
+    }
+
+    if (m_items.size() < size_t(m_k)) {
+        int item = int(m_items.size());
+        m_items.push_back(Item{ a, b, set, int64_t(estimate) });
+        m_hashes.push_back(hash);
+        insertIndex(item);
+        m_heap.push_back(item);
+        m_heapPos.push_back(item);
+        siftUp(item);
+    } else if (int64_t(estimate) > m_items[size_t(m_heap[0])].count) {
+        // The new key overtook the weakest one kept: take its place
+        int victim = m_heap[0];
+        eraseIndex(victim);
+        m_items[size_t(victim)] = Item{ a, b, set, int64_t(estimate) };
+        m_hashes[size_t(victim)] = hash;
+        insertIndex(victim);
+        siftDown(0);
+    }
+}
+
+int64_t HeavyHitters::errorBound() const
+{
+    // Count-min: over e * total / width with probability below e^-depth
+    return int64_t(std::ceil(2.718281828 * double(m_total) / SKETCH_WIDTH));
+}
+
+std::vector<HeavyHitters::Item> HeavyHitters::top() const
+{
+    std::vector<Item> items = m_items;
+    // Ties broken on the key, so reports don't depend on the sort used
+    std::sort(items.begin(), items.end(), [](const Item &x, const Item &y) {
+        if (x.count != y.count)
+            return x.count > y.count;
+        return x.a != y.a ? x.a < y.a : x.b != y.b ? x.b < y.b : x.set < y.set;
+    });
+    return items;
+}
+
+ConflictProfiler::ConflictProfiler(const CacheEngine &engine, int topK, int64_t regionBytes, int sampleEvery)
+    : m_numSets(engine.numSets())
+    , m_blockSize(engine.blockSize())
+    , m_topK(topK > 0 ? topK : 1)
+    , m_sampleEvery(sampleEvery > 0 ? sampleEvery : 1)
+    , m_setMisses(size_t(engine.numSets()), 0)
+    , m_setEvictions(size_t(engine.numSets()), 0)
+    , m_blocks(m_topK)
+    , m_pairs(m_topK)
+    , m_regions(m_topK * 4)   // extra room so neighbouring regions can be merged
+{
+    m_regionBlocks = regionBytes / m_blockSize;
+    if (m_regionBlocks < 1)
+        m_regionBlocks = 1;
+    m_skip = nextGap();
+}
+
+// 1 to 2N - 1 misses, N on average
+int ConflictProfiler::nextGap()
+{
+    if (m_sampleEvery == 1)
+        return 1;
+    // xorshift64*
+    m_random ^= m_random >> 12;
+    m_random ^= m_random << 25;
+    m_random ^= m_random >> 27;
+    return 1 + int(((m_random * 0x2545F4914F6CDD1Dull) >> 33) % uint64_t(2 * m_sampleEvery - 1));
+}
+
+std::vector<HeavyHitters::Item> ConflictProfiler::scaled(std::vector<HeavyHitters::Item> items) const
+{
+    for (HeavyHitters::Item &item : items)
+        item.count *= m_sampleEvery;
+    return items;
+}
+
+void ConflictProfiler::recordMiss(const CacheEngine::AccessResult &result)
+{
+    const int set = result.setIndex;
+    m_setMisses[size_t(set)]++;
+    if (result.evicted)
+        m_setEvictions[size_t(set)]++;
+    if (--m_skip > 0)
+        return;
+    m_skip = nextGap();
+
+    m_blocks.add(result.blockAddress, -1, set);
+    m_regions.add(result.blockAddress / m_regionBlocks, -1, set);
+    if (result.evicted) {
+        int64_t a = std::min(result.blockAddress, result.evictedBlock);
+        int64_t b = std::max(result.blockAddress, result.evictedBlock);
+        m_pairs.add(a, b, set);
+    }
+}
+
+std::vector<ConflictProfiler::Range> ConflictProfiler::thrashingRanges() const
+{
+    std::vector<HeavyHitters::Item> regions = scaled(m_regions.top());
+    std::sort(regions.begin(), regions.end(), [](const HeavyHitters::Item &x, const HeavyHitters::Item &y) {
+        return x.set != y.set ? x.set < y.set : x.a < y.a;
+    });
+
+    const int64_t regionBytes = m_regionBlocks * m_blockSize;
+    std::vector<Range> ranges;
+    for (const HeavyHitters::Item &item : regions) {
+        if (!ranges.empty() && ranges.back().set == item.set && ranges.back().end == item.a * regionBytes) {
+            ranges.back().end += regionBytes;
+            ranges.back().misses += item.count;
+        } else {
+            ranges.push_back(Range{ item.a * regionBytes, (item.a + 1) * regionBytes, item.set, item.count });
+        }
+    }
+
+    std::sort(ranges.begin(), ranges.end(), [](const Range &x, const Range &y) {
+        if (x.misses != y.misses)
+            return x.misses > y.misses;
+        return x.start != y.start ? x.start < y.start : x.set < y.set;
+    });
+    if (ranges.size() > size_t(m_topK))
+        ranges.resize(size_t(m_topK));
+    return ranges;
+}
+
+std::string ConflictProfiler::report() const
+{
+    std::string out;
+    int64_t misses = std::accumulate(m_setMisses.begin(), m_setMisses.end(), int64_t(0));
+    int64_t evictions = std::accumulate(m_setEvictions.begin(), m_setEvictions.end(), int64_t(0));
+    appendf(out, "%d sets, %lld misses, %lld evictions\n", m_numSets, (long long)misses, (long long)evictions);
+    if (m_sampleEvery > 1) {
+        appendf(out, "Counts marked ~ are estimates from about 1 in %d misses, scaled up:\n"
+                     "off either way by about the square root of %d x count, and by up\n"
+                     "to the +N given in the section title on top.\n", m_sampleEvery, m_sampleEvery);
+    } else {
+        appendf(out, "Counts marked ~ are estimates: never too low, and almost always\n"
+                     "at most the +N given in the section title too high.\n");
+    }
+
+    std::vector<int> sets(static_cast<size_t>(m_numSets));
+    std::iota(sets.begin(), sets.end(), 0);
+    size_t shown = std::min(sets.size(), size_t(m_topK));
+    std::partial_sort(sets.begin(), sets.begin() + long(shown), sets.end(), [&](int x, int y) {
+        return m_setMisses[size_t(x)] != m_setMisses[size_t(y)] ? m_setMisses[size_t(x)] > m_setMisses[size_t(y)] : x < y;
+    });
+    appendf(out, "\nSets with the most misses:\n");
+    appendf(out, "  %8s %12s %12s %8s\n", "set", "misses", "evictions", "share");
+    for (size_t i = 0; i < shown && m_setMisses[size_t(sets[i])] > 0; ++i) {
+        int set = sets[i];
+        appendf(out, "  %8d %12lld %12lld %7.2f%%\n", set, (long long)m_setMisses[size_t(set)],
+                (long long)m_setEvictions[size_t(set)], misses ? 100.0 * m_setMisses[size_t(set)] / misses : 0.0);
+    }
+
+    appendf(out, "\nBlocks that miss the most (+%lld):\n", (long long)(m_blocks.errorBound() * m_sampleEvery));
+    for (const HeavyHitters::Item &item : missingBlocks()) {
+        appendf(out, "  block 0x%llx (bytes 0x%llx-0x%llx)  set %d  ~%lld misses\n",
+                (long long)item.a, (long long)(item.a * m_blockSize),
+                (long long)((item.a + 1) * m_blockSize - 1), item.set, (long long)item.count);
+    }
+
+    appendf(out, "\nBlocks that keep evicting each other (+%lld):\n", (long long)(m_pairs.errorBound() * m_sampleEvery));
+    for (const HeavyHitters::Item &item : conflictPairs()) {
+        appendf(out, "  set %d  0x%llx <-> 0x%llx  ~%lld evictions\n", item.set,
+                (long long)(item.a * m_blockSize), (long long)(item.b * m_blockSize), (long long)item.count);
+    }
+
+    appendf(out, "\nAddress ranges thrashing a set (+%lld per %lld KB region):\n",
+            (long long)(m_regions.errorBound() * m_sampleEvery), (long long)((m_regionBlocks * m_blockSize + 1023) / 1024));
+    for (const Range &range : thrashingRanges()) {
+        appendf(out, "  0x%llx-0x%llx (%lld KB) -> set %d  ~%lld misses\n", (long long)range.start,
+                (long long)(range.end - 1), (long long)((range.end - range.start + 1023) / 1024), range.set,
+                (long long)range.misses);
+    }
+    return out;
+}
+
+bool ConflictProfiler::writeReport(const std::string &path, std::string *error) const
+{
+    FILE *f = std::fopen(path.c_str(), "w");
+    if (!f) {
+        if (error)
+            *error = "cannot open " + path + " for writing";
+        return false;
+    }
+
+    std::string text = report();
+    std::fwrite(text.data(), 1, text.size(), f);
+
+    if (std::fclose(f) != 0) {
+        if (error)
+            *error = "short write to " + path;
+        return false;
+    }
+    return true;
+}
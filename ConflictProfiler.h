@@ -0,0 +1,120 @@
+#ifndef CONFLICTPROFILER_H
+#define CONFLICTPROFILER_H
+
+#include "CacheEngine.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Approximate top-K counter with a fixed memory footprint, however long
+// the stream: a count-min sketch estimates every key's count and only the
+// K keys with the highest estimates are remembered. Counts are upper
+// bounds, off by at most about total * e / SKETCH_WIDTH.
+//
+// A key is two addresses and a set number; unused parts are -1.
+class HeavyHitters
+{
+public:
+    static const int SKETCH_DEPTH = 4;
+    static const int SKETCH_WIDTH = 1024;   // power of two
+
+    struct Item {
+        int64_t a;
+        int64_t b;
+        int set;
+        int64_t count;
+    };
+
+    explicit HeavyHitters(int k);
+
+    void add(int64_t a, int64_t b, int set);
+
+    // Highest count first
+    std::vector<Item> top() const;
+
+    // How much an estimate is typically (with ~98% probability) too high
+    int64_t errorBound() const;
+
+private:
+    int m_k;
+    std::vector<uint64_t> m_sketch;   // [row * SKETCH_WIDTH + column]
+    std::vector<Item> m_items;        // at most k
+    std::vector<uint64_t> m_hashes;   // per item
+    std::vector<int> m_index;         // linear probing over m_items, -1 = free
+    std::vector<int> m_heap;          // item numbers, min-heap on count
+    std::vector<int> m_heapPos;       // per item, where it sits in m_heap
+    int64_t m_total = 0;
+
+    int find(uint64_t hash, int64_t a, int64_t b, int set) const;
+    void insertIndex(int item);
+    void eraseIndex(int item);
+    void siftUp(int pos);
+    void siftDown(int pos);
+};
+
+// Aggregates what the step log only shows one access at a time: which sets
+// miss and evict the most, which blocks miss the most, which pairs of
+// blocks keep evicting each other, and which address ranges pile onto
+// which sets. Feed it every AccessResult of a run.
+//
+// Memory is a few counters per set plus three fixed-size HeavyHitters.
+// The per-set counts are exact. The HeavyHitters cost about 60 ns per
+// update, so with sampleEvery N > 1 they only see about 1 in N misses,
+// picked at random gaps so a loop can't line up with the sampling, and
+// their counts are scaled back up by N.
+class ConflictProfiler
+{
+public:
+    struct Range {
+        int64_t start;    // byte addresses, end exclusive
+        int64_t end;
+        int set;
+        int64_t misses;
+    };
+
+    // regionBytes is the granularity address ranges are built from
+    ConflictProfiler(const CacheEngine &engine, int topK = 16, int64_t regionBytes = 4096, int sampleEvery = 1);
+
+    // Hits change nothing, so only misses pay for a call
+    void record(const CacheEngine::AccessResult &result)
+    {
+        if (!result.hit)
+            recordMiss(result);
+    }
+
+    const std::vector<int64_t> &setMisses() const { return m_setMisses; }
+    const std::vector<int64_t> &setEvictions() const { return m_setEvictions; }
+
+    // a = block address, count = misses
+    std::vector<HeavyHitters::Item> missingBlocks() const { return scaled(m_blocks.top()); }
+    // a and b = the two blocks (a < b), count = evictions of one by the other
+    std::vector<HeavyHitters::Item> conflictPairs() const { return scaled(m_pairs.top()); }
+    // Neighbouring regions that thrash the same set merged into one range
+    std::vector<Range> thrashingRanges() const;
+
+    // Human-readable summary of all of the above
+    std::string report() const;
+    bool writeReport(const std::string &path, std::string *error = nullptr) const;
+
+private:
+    int m_numSets;
+    int m_blockSize;
+    int m_topK;
+    int64_t m_regionBlocks;   // region size in blocks
+    int m_sampleEvery;
+    int m_skip = 1;           // misses left until the next sampled one
+    uint64_t m_random = 0x853C49E6748FEA9Bull;
+
+    std::vector<int64_t> m_setMisses;
+    std::vector<int64_t> m_setEvictions;
+    HeavyHitters m_blocks;
+    HeavyHitters m_pairs;
+    HeavyHitters m_regions;   // a = region number
+
+    void recordMiss(const CacheEngine::AccessResult &result);
+    int nextGap();
+    std::vector<HeavyHitters::Item> scaled(std::vector<HeavyHitters::Item> items) const;
+};
+
+#endif // CONFLICTPROFILER_H
@@ -0,0 +1,104 @@
+#include "IntervalStats.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+IntervalStats::IntervalStats(int intervalLength, double phaseThreshold)
+    : m_intervalLength(intervalLength > 0 ? intervalLength : 1)
+    , m_phaseThreshold(phaseThreshold)
+{
+    clear();
+}
+
+void IntervalStats::clear()
+{
+    m_samples.clear();
+    m_totalAccesses = 0;
+    m_phase = 0;
+    m_havePrevious = false;
+    std::memset(m_previousSignature, 0, sizeof(m_previousSignature));
+    startInterval();
+}
+
+void IntervalStats::startInterval()
+{
+    std::memset(&m_current, 0, sizeof(m_current));
+    m_current.firstAccess = m_totalAccesses;
+    std::memset(m_signature, 0, sizeof(m_signature));
+}
+
+void IntervalStats::record(const CacheEngine::AccessResult &result)
+{
+    m_current.accesses++;
+    if (result.hit)
+        m_current.hits++;
+    else
+        m_current.misses++;
+    if (result.evicted)
+        m_current.evictions++;
+
+    // Fibonacci hash of the block address picks the signature bucket
+    uint64_t h = uint64_t(result.blockAddress) * 0x9E3779B97F4A7C15ull;
+    m_signature[h >> 58]++;   // top 6 bits -> 64 buckets
+
+    m_totalAccesses++;
+    if (m_current.accesses == m_intervalLength)
+        flush();
+}
+
+void IntervalStats::flush()
+{
+    if (m_current.accesses == 0)
+        return;
+
+    m_current.mpki = float(1000.0 * m_current.misses / m_current.accesses);
+
+    // Half the L1 distance of the two normalised histograms, so 0 = same, 1 = disjoint
+    double distance = 0.0;
+    if (m_havePrevious) {
+        double total = 0.0;
+        double previousTotal = 0.0;
+        for (int i = 0; i < SIGNATURE_BUCKETS; ++i) {
+            total += m_signature[i];
+            previousTotal += m_previousSignature[i];
+        }
+        for (int i = 0; i < SIGNATURE_BUCKETS; ++i)
+            distance += std::fabs(m_signature[i] / total - m_previousSignature[i] / previousTotal);
+        distance *= 0.5;
+
+        if (distance > m_phaseThreshold)
+            m_phase++;
+    }
+    m_current.distance = float(distance);
+    m_current.phase = m_phase;
+    m_samples.push_back(m_current);
+
+    std::memcpy(m_previousSignature, m_signature, sizeof(m_signature));
+    m_havePrevious = true;
+    startInterval();
+}
+
+bool IntervalStats::exportCsv(const std::string &path, std::string *error) const
+{
+    FILE *f = std::fopen(path.c_str(), "w");
+    if (!f) {
+        if (error)
+            *error = "cannot open " + path + " for writing";
+        return false;
+    }
+
+    std::fprintf(f, "first_access,accesses,hits,misses,evictions,mpki,signature_distance,phase\n");
+    for (const Sample &s : m_samples) {
+        std::fprintf(f, "%lld,%d,%d,%d,%d,%.3f,%.4f,%d\n",
+                     static_cast<long long>(s.firstAccess), s.accesses, s.hits, s.misses,
+                     s.evictions, s.mpki, s.distance, s.phase);
+    }
+
+    if (std::fclose(f) != 0) {
+        if (error)
+            *error = "short write to " + path;
+        return false;
+    }
+    return true;
+}
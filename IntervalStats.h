@@ -0,0 +1,64 @@
+#ifndef INTERVALSTATS_H
+#define INTERVALSTATS_H
+
+#include "CacheEngine.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Cuts a run into intervals of N accesses and keeps one small sample per
+// interval (hits, misses, evictions, MPKI) so long traces can be looked at
+// as a time series instead of a single total.
+//
+// Phase detection works like a basic-block vector, but over data: every
+// block touched in an interval is hashed into a few buckets, and when the
+// normalised bucket histogram moves far enough away from the previous
+// interval's one, the workload is considered to have changed phase.
+class IntervalStats
+{
+public:
+    static const int SIGNATURE_BUCKETS = 64;
+
+    struct Sample {
+        int64_t firstAccess;   // access number the interval starts at
+        int32_t accesses;
+        int32_t hits;
+        int32_t misses;
+        int32_t evictions;
+        float mpki;            // misses per 1000 accesses (every access is one instruction)
+        float distance;        // working-set signature distance to the previous interval, 0..1
+        int32_t phase;         // phase id, bumped on every detected change
+    };
+
+    explicit IntervalStats(int intervalLength = 1000, double phaseThreshold = 0.5);
+
+    void record(const CacheEngine::AccessResult &result);
+
+    // Close the current, partially filled interval (if it has any accesses)
+    void flush();
+    void clear();
+
+    int intervalLength() const { return m_intervalLength; }
+    const std::vector<Sample> &samples() const { return m_samples; }
+
+    // One line per interval, with a header row
+    bool exportCsv(const std::string &path, std::string *error = nullptr) const;
+
+private:
+    int m_intervalLength;
+    double m_phaseThreshold;
+
+    std::vector<Sample> m_samples;
+    Sample m_current;
+    int64_t m_totalAccesses = 0;
+    int32_t m_phase = 0;
+
+    uint32_t m_signature[SIGNATURE_BUCKETS];
+    uint32_t m_previousSignature[SIGNATURE_BUCKETS];
+    bool m_havePrevious = false;
+
+    void startInterval();
+};
+
+#endif // INTERVALSTATS_H
@@ -0,0 +1,165 @@
+#include "Mmu.h"
+
+namespace {
+
+const int LEVELS = 4;
+const int BITS_PER_LEVEL = 9;                 // 512 eight-byte entries per 4K table
+const int64_t TABLE_BYTES = 4096;
+const int64_t PTE_BYTES = 8;
+
+// Lowest virtual address bit the entry at this level covers (39 for the top
+// level, 12 for the last one with 4K pages)
+int levelShift(int level)
+{
+    return 12 + BITS_PER_LEVEL * (LEVELS - 1 - level);
+}
+
+// Page-walk cache key for the entry covering virtualAddress at this level
+int64_t entryKey(int64_t virtualAddress, int level)
+{
+    return ((virtualAddress >> levelShift(level)) << 2) | level;
+}
+
+void configureTlb(CacheEngine &tlb, const Mmu::TlbConfig &config, int policy)
+{
+    if (config.entries <= 0)
+        return;
+    tlb.setStoreData(false);
+    tlb.configure(config.entries, 1, config.ways, policy);
+}
+
+} // namespace
+
+Mmu::Mmu(const Config &config)
+    : m_config(config)
+{
+    m_leafLevel = LEVELS - 1 - (int(config.pageSize) - 12) / BITS_PER_LEVEL;
+
+    configureTlb(m_l1, config.l1, config.policy);
+    configureTlb(m_l2, config.l2, config.policy);
+    configureTlb(m_walkCache, TlbConfig{ config.walkCacheEntries, 0 }, config.policy);
+
+    // The TLBs only know page numbers; the frame for each line sits here
+    m_l1Frames.assign(size_t(m_l1.numSets()) * m_l1.numWays(), 0);
+    m_l2Frames.assign(size_t(m_l2.numSets()) * m_l2.numWays(), 0);
+
+    m_walkTables.assign(size_t(m_walkCache.numSets()) * m_walkCache.numWays(), 0);
+
+    newTable();
+}
+
+int64_t Mmu::allocate(int64_t bytes)
+{
+    m_nextFrame = (m_nextFrame + bytes - 1) / bytes * bytes;
+    int64_t frame = m_nextFrame;
+    m_nextFrame += bytes;
+    return frame;
+}
+
+int64_t Mmu::newTable()
+{
+    m_tables.push_back(Table{ allocate(TABLE_BYTES), std::vector<int64_t>(size_t(1) << BITS_PER_LEVEL, -1) });
+    return int64_t(m_tables.size()) - 1;
+}
+
+int64_t Mmu::translate(int64_t virtualAddress, CacheEngine *dataCache)
+{
+    const int64_t pageNumber = virtualAddress >> m_config.pageSize;
+    const int64_t offset = virtualAddress & ((int64_t(1) << m_config.pageSize) - 1);
+    m_stats.translations++;
+
+    size_t l1Slot = 0;
+    bool haveL1 = m_config.l1.entries > 0;
+    if (haveL1) {
+        CacheEngine::AccessResult r = m_l1.access(pageNumber);
+        l1Slot = size_t(r.setIndex) * m_l1.numWays() + r.way;
+        if (r.hit)
+            return m_l1Frames[l1Slot] | offset;
+    }
+    m_stats.l1Misses++;
+
+    int64_t frame;
+    CacheEngine::AccessResult r2 = {};
+    bool haveL2 = m_config.l2.entries > 0;
+    if (haveL2)
+        r2 = m_l2.access(pageNumber);
+    size_t l2Slot = size_t(r2.setIndex) * m_l2.numWays() + r2.way;
+    if (haveL2 && r2.hit) {
+        frame = m_l2Frames[l2Slot];
+    } else {
+        m_stats.l2Misses++;
+        frame = walk(virtualAddress, dataCache);
+        if (haveL2)
+            m_l2Frames[l2Slot] = frame;
+    }
+
+    if (haveL1)
+        m_l1Frames[l1Slot] = frame;
+    return frame | offset;
+}
+
+int64_t Mmu::walk(int64_t virtualAddress, CacheEngine *dataCache)
+{
+    // Deepest upper-level entry the page-walk cache still has. The lookups
+    // only probe: filling on a miss would let the shallower probes of the
+    // same walk push out the deeper entries it is about to resolve.
+    const bool walkCache = m_config.walkCacheEntries > 0;
+    int firstLevel = 0;
+    int64_t table = 0;
+    if (walkCache) {
+        for (int level = m_leafLevel - 1; level >= 0; --level) {
+            int64_t key = entryKey(virtualAddress, level);
+            m_stats.pwcAccesses++;
+            if (m_walkCache.contains(key)) {
+                CacheEngine::AccessResult r = m_walkCache.access(key);   // a hit: only updates LRU
+                m_stats.pwcHits++;
+                table = m_walkTables[size_t(r.setIndex) * m_walkCache.numWays() + r.way];
+                firstLevel = level + 1;
+                break;
+            }
+        }
+    }
+
+    for (int level = firstLevel; level <= m_leafLevel; ++level) {
+        const int index = int((virtualAddress >> levelShift(level)) & ((1 << BITS_PER_LEVEL) - 1));
+        int64_t pte = m_tables[size_t(table)].base + index * PTE_BYTES;
+        m_stats.walkReferences++;
+        if (dataCache && dataCache->access(pte).hit)
+            m_stats.walkCacheHits++;
+
+        // Not mapped yet: the "OS" hands out the next free frame
+        int64_t next = m_tables[size_t(table)].entries[size_t(index)];
+        if (next < 0) {
+            if (level == m_leafLevel) {
+                next = allocate(int64_t(1) << m_config.pageSize);
+                m_stats.pagesMapped++;
+            } else {
+                next = newTable();
+            }
+            m_tables[size_t(table)].entries[size_t(index)] = next;
+        }
+
+        // Every upper-level entry read from memory goes into the page-walk
+        // cache with the table it points to, shallowest first so the
+        // deepest (most useful) one is the last to be evicted
+        if (walkCache && level < m_leafLevel) {
+            CacheEngine::AccessResult r = m_walkCache.access(entryKey(virtualAddress, level));
+            m_walkTables[size_t(r.setIndex) * m_walkCache.numWays() + r.way] = next;
+        }
+        table = next;
+    }
+    return table;
+}
+
+CacheEngine::AccessResult Mmu::access(CacheEngine &cache, int64_t virtualAddress)
+{
+    int64_t physicalAddress = translate(virtualAddress, &cache);
+    return cache.access(physicalAddress, m_config.indexing == VIPT ? virtualAddress : physicalAddress);
+}
+
+bool Mmu::hasSynonyms(const CacheEngine &cache) const
+{
+    if (m_config.indexing != VIPT || cache.numSets() <= 1)
+        return false;
+    return int64_t(cache.numSets()) * cache.blockSize() > (int64_t(1) << m_config.pageSize);
+}
@@ -0,0 +1,106 @@
+#ifndef MMU_H
+#define MMU_H
+
+#include "CacheEngine.h"
+
+#include <cstdint>
+#include <vector>
+
+// Virtual-memory front-end for a CacheEngine: trace addresses are taken as
+// virtual, translated through an L1 and an L2 TLB and, when both miss, an
+// x86-64 style four-level page-table walk over 48-bit virtual addresses.
+//
+// The TLBs are CacheEngines themselves, fed with virtual page numbers and a
+// block size of 1, so one "block" is one page and sets, ways and LRU/FIFO
+// work exactly like in the data cache. Pages are mapped on first touch to
+// physical frames handed out in order; page tables get their own frames.
+//
+// Every page-table entry the walker reads goes through the data cache, the
+// way a hardware walker does, so those reads show up in the cache totals.
+// A small page-walk cache keeps upper-level entries so most walks only read
+// the last level or two.
+class Mmu
+{
+public:
+    // Values are log2 of the page size
+    enum PageSize {
+        Page4K = 12,
+        Page2M = 21,
+        Page1G = 30
+    };
+
+    enum Indexing {
+        PIPT,   // set index from the physical address (after translation)
+        VIPT    // set index from the virtual address, tag from the physical one
+    };
+
+    struct TlbConfig {
+        int entries;   // 0 leaves this level out
+        int ways;      // 0 = fully associative
+    };
+
+    struct Config {
+        PageSize pageSize = Page4K;
+        Indexing indexing = PIPT;
+        TlbConfig l1 = { 64, 4 };
+        TlbConfig l2 = { 1536, 12 };
+        int walkCacheEntries = 32;   // fully associative; 0 leaves it out
+        int policy = CacheEngine::LRU;
+    };
+
+    struct Stats {
+        int64_t translations;
+        int64_t l1Misses;
+        int64_t l2Misses;          // every one of these is a page walk
+        int64_t walkReferences;    // page-table entries read by the walker
+        int64_t walkCacheHits;     // ...of which hit in the data cache
+        int64_t pwcAccesses;       // page-walk cache lookups
+        int64_t pwcHits;
+        int64_t pagesMapped;
+    };
+
+    explicit Mmu(const Config &config);
+
+    // Virtual to physical. PTE reads go to dataCache when one is given.
+    int64_t translate(int64_t virtualAddress, CacheEngine *dataCache = nullptr);
+
+    // Translate, then look the address up in cache with PIPT or VIPT indexing
+    CacheEngine::AccessResult access(CacheEngine &cache, int64_t virtualAddress);
+
+    // With VIPT, true when the set index needs bits above the page offset:
+    // then one physical block can sit in two sets (synonyms)
+    bool hasSynonyms(const CacheEngine &cache) const;
+
+    const Config &config() const { return m_config; }
+    const Stats &stats() const { return m_stats; }
+    int pageBits() const { return int(m_config.pageSize); }
+
+private:
+    // One page table: where it sits in physical memory and its 512 entries.
+    // An entry holds the index of the next table, or the page frame at the
+    // leaf level; -1 while not mapped.
+    struct Table {
+        int64_t base;
+        std::vector<int64_t> entries;
+    };
+
+    int64_t walk(int64_t virtualAddress, CacheEngine *dataCache);
+    int64_t allocate(int64_t bytes);
+    int64_t newTable();
+
+    Config m_config;
+    Stats m_stats = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    int m_leafLevel;              // 3 for 4K pages, 2 for 2M, 1 for 1G
+
+    CacheEngine m_l1;
+    CacheEngine m_l2;
+    CacheEngine m_walkCache;      // keys are (prefix << 2 | level)
+    std::vector<int64_t> m_l1Frames;     // frame base per TLB line, [set * ways + way]
+    std::vector<int64_t> m_l2Frames;
+    std::vector<int64_t> m_walkTables;   // next table index per page-walk cache line
+
+    std::vector<Table> m_tables;  // [0] is the root
+    int64_t m_nextFrame = 0;      // physical bump allocator
+};
+
+#endif // MMU_H
@@ -0,0 +1,180 @@
+#include "Sampling.h"
+
+#include <cmath>
+
+namespace {
+
+const double Z_95 = 1.96;
+
+// Small integer mixer so neighbouring sets don't get picked together
+uint32_t mix(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352dU;
+    x ^= x >> 15;
+    x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+}
+
+double clamp01(double v)
+{
+    return v < 0.0 ? 0.0 : (v > 1.0 ? 1.0 : v);
+}
+
+} // namespace
+
+SetSampler::SetSampler(CacheEngine &engine, int ratio, uint32_t seed)
+    : m_engine(engine)
+{
+    int numSets = engine.numSets();
+    if (ratio < 1)
+        ratio = 1;
+
+    m_sampled.assign(size_t(numSets), 0);
+    for (int set = 0; set < numSets; ++set) {
+        if (mix(uint32_t(set) ^ seed) % uint32_t(ratio) == 0) {
+            m_sampled[size_t(set)] = 1;
+            m_sampledSets++;
+        }
+    }
+    if (m_sampledSets == 0) {
+        m_sampled[0] = 1;
+        m_sampledSets = 1;
+    }
+
+    m_accesses.assign(size_t(numSets), 0);
+    m_misses.assign(size_t(numSets), 0);
+}
+
+void SetSampler::access(int64_t byteAddress)
+{
+    m_totalAccesses++;
+
+    int set = m_engine.setIndexOf(m_engine.blockOf(byteAddress));
+    if (!m_sampled[size_t(set)])
+        return;
+
+    CacheEngine::AccessResult r = m_engine.access(byteAddress);
+    m_simulatedAccesses++;
+    m_accesses[size_t(set)]++;
+    if (!r.hit)
+        m_misses[size_t(set)]++;
+}
+
+SampleEstimate SetSampler::estimate() const
+{
+    SampleEstimate e;
+    e.totalAccesses = m_totalAccesses;
+    e.simulatedAccesses = m_simulatedAccesses;
+    e.samples = m_sampledSets;
+
+    int64_t misses = 0;
+    for (size_t set = 0; set < m_misses.size(); ++set)
+        misses += m_misses[set];
+    e.missRate = m_simulatedAccesses ? double(misses) / m_simulatedAccesses : 0.0;
+
+    // Ratio estimator over the sampled sets (cluster sampling), with the
+    // finite population correction since there are only numSets clusters
+    double halfWidth = 0.0;
+    int n = m_sampledSets;
+    int N = m_engine.numSets();
+    if (n > 1 && m_simulatedAccesses > 0) {
+        double meanAccesses = double(m_simulatedAccesses) / n;
+        double sum = 0.0;
+        for (size_t set = 0; set < m_sampled.size(); ++set) {
+            if (!m_sampled[set])
+                continue;
+            double d = m_misses[set] - e.missRate * m_accesses[set];
+            sum += d * d;
+        }
+        double variance = (1.0 - double(n) / N) * sum / (double(n) * (n - 1) * meanAccesses * meanAccesses);
+        halfWidth = Z_95 * std::sqrt(variance);
+    }
+    e.confidenceLow = clamp01(e.missRate - halfWidth);
+    e.confidenceHigh = clamp01(e.missRate + halfWidth);
+    e.estimatedMisses = int64_t(std::llround(e.missRate * m_totalAccesses));
+    return e;
+}
+
+IntervalSampler::IntervalSampler(CacheEngine &engine, int64_t period, int64_t warmup, int64_t measure)
+    : m_engine(engine)
+{
+    if (measure < 1)
+        measure = 1;
+    if (period < measure)
+        period = measure;
+    if (warmup < 0)
+        warmup = 0;
+    if (warmup > period - measure)
+        warmup = period - measure;
+
+    m_period = period;
+    m_warmup = warmup;
+    m_skip = period - measure - warmup;
+}
+
+void IntervalSampler::access(int64_t byteAddress)
+{
+    m_totalAccesses++;
+
+    if (m_position < m_skip) {
+        // fast-forward: not simulated at all
+    } else if (m_position < m_skip + m_warmup) {
+        m_engine.warm(byteAddress);
+    } else {
+        CacheEngine::AccessResult r = m_engine.access(byteAddress);
+        m_simulatedAccesses++;
+        m_unitAccesses++;
+        if (!r.hit)
+            m_unitMisses++;
+    }
+
+    if (++m_position == m_period) {
+        m_position = 0;
+        closeUnit();
+    }
+}
+
+void IntervalSampler::closeUnit()
+{
+    if (m_unitAccesses > 0)
+        m_unitMissRates.push_back(float(double(m_unitMisses) / m_unitAccesses));
+    m_unitAccesses = 0;
+    m_unitMisses = 0;
+}
+
+SampleEstimate IntervalSampler::estimate() const
+{
+    // A unit the trace cut short would count as much as a whole one, so it
+    // is left out, unless the trace ended before the first unit did
+    std::vector<float> rates = m_unitMissRates;
+    if (rates.empty() && m_unitAccesses > 0)
+        rates.push_back(float(double(m_unitMisses) / m_unitAccesses));
+
+    SampleEstimate e;
+    e.totalAccesses = m_totalAccesses;
+    e.simulatedAccesses = m_simulatedAccesses;
+    e.samples = int64_t(rates.size());
+
+    double mean = 0.0;
+    for (float rate : rates)
+        mean += rate;
+    mean = rates.empty() ? 0.0 : mean / rates.size();
+
+    // Complete units are equally long, so the plain sample mean and its standard error
+    double halfWidth = 0.0;
+    if (rates.size() > 1) {
+        double sum = 0.0;
+        for (float rate : rates)
+            sum += (rate - mean) * (rate - mean);
+        double stddev = std::sqrt(sum / (rates.size() - 1));
+        halfWidth = Z_95 * stddev / std::sqrt(double(rates.size()));
+    }
+
+    e.missRate = mean;
+    e.confidenceLow = clamp01(mean - halfWidth);
+    e.confidenceHigh = clamp01(mean + halfWidth);
+    e.estimatedMisses = int64_t(std::llround(mean * m_totalAccesses));
+    return e;
+}
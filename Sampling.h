@@ -0,0 +1,79 @@
+#ifndef SAMPLING_H
+#define SAMPLING_H
+
+#include "CacheEngine.h"
+
+#include <cstdint>
+#include <vector>
+
+// Ways to estimate the miss rate of a very long trace without simulating
+// every access in detail. Both samplers drive an already configured
+// CacheEngine and report the estimate with a 95% confidence interval.
+
+struct SampleEstimate {
+    int64_t totalAccesses;      // accesses seen in the trace
+    int64_t simulatedAccesses;  // accesses that were measured in detail
+    int64_t samples;            // number of sampled units (sets or intervals)
+    double missRate;
+    double confidenceLow;       // 95% interval around missRate
+    double confidenceHigh;
+    int64_t estimatedMisses;    // missRate scaled to the whole trace
+};
+
+// Set sampling: only sets whose hashed index falls in 1 of every `ratio`
+// buckets are simulated; accesses to the other sets are dropped right after
+// the index is computed. Each sampled set is one cluster for the interval.
+class SetSampler
+{
+public:
+    SetSampler(CacheEngine &engine, int ratio, uint32_t seed = 0);
+
+    void access(int64_t byteAddress);
+    SampleEstimate estimate() const;
+
+    int sampledSets() const { return m_sampledSets; }
+
+private:
+    CacheEngine &m_engine;
+    std::vector<uint8_t> m_sampled;    // per set: 1 if simulated
+    std::vector<int64_t> m_accesses;   // per set, sampled sets only
+    std::vector<int64_t> m_misses;
+    int m_sampledSets = 0;
+    int64_t m_totalAccesses = 0;
+    int64_t m_simulatedAccesses = 0;
+};
+
+// Interval (SMARTS-style systematic) sampling. The trace is cut into
+// periods; each period is
+//     [ skipped | functional warming | measured ]
+// Skipped accesses never reach the engine, warming ones only update the
+// tags (CacheEngine::warm) and measured ones are simulated in full.
+// Setting warmup = period - measure gives continuous functional warming
+// as in SMARTS; shorter warmups trade accuracy for speed. The estimate
+// only uses measured units of whole periods; the trace's last, partial
+// period is left out unless there is no whole one.
+class IntervalSampler
+{
+public:
+    IntervalSampler(CacheEngine &engine, int64_t period, int64_t warmup, int64_t measure);
+
+    void access(int64_t byteAddress);
+    SampleEstimate estimate() const;
+
+private:
+    CacheEngine &m_engine;
+    int64_t m_skip;
+    int64_t m_warmup;
+    int64_t m_period;
+
+    int64_t m_position = 0;            // position inside the current period
+    int64_t m_totalAccesses = 0;
+    int64_t m_simulatedAccesses = 0;
+    int64_t m_unitAccesses = 0;        // current measured unit
+    int64_t m_unitMisses = 0;
+    std::vector<float> m_unitMissRates;
+
+    void closeUnit();
+};
+
+#endif // SAMPLING_H
@@ -0,0 +1,138 @@
+#include "TimelineWindow.h"
+#include "ui_TimelineWindow.h"
+
+#include <QFileDialog>
+#include <QGraphicsLineItem>
+#include <QGraphicsTextItem>
+#include <QMessageBox>
+#include <QPen>
+
+#include <vector>
+
+namespace {
+
+// Long runs are drawn with neighbouring intervals merged, so a jump over
+// tens of thousands of instructions still gives a chart that fits on screen
+const size_t MAX_COLUMNS = 60;
+
+struct Column {
+    int64_t firstAccess;
+    int64_t accesses;
+    int64_t misses;
+    int32_t phase;         // phase at the end of the column
+    bool phaseChange;      // the phase changed at or inside this column
+};
+
+std::vector<Column> mergeSamples(const std::vector<IntervalStats::Sample> &samples, size_t perColumn)
+{
+    std::vector<Column> columns;
+    for (size_t i = 0; i < samples.size(); i += perColumn) {
+        const IntervalStats::Sample &first = samples[i];
+        Column column = { first.firstAccess, 0, 0, first.phase, i > 0 && first.phase != samples[i - 1].phase };
+        for (size_t j = i; j < samples.size() && j < i + perColumn; ++j) {
+            column.accesses += samples[j].accesses;
+            column.misses += samples[j].misses;
+            column.phaseChange = column.phaseChange || (j > i && samples[j].phase != samples[j - 1].phase);
+            column.phase = samples[j].phase;
+        }
+        columns.push_back(column);
+    }
+    return columns;
+}
+
+} // namespace
+
+TimelineWindow::TimelineWindow(const IntervalStats &stats, QWidget *parent) :
+    QDialog(parent),
+    ui(new Ui::TimelineWindow),
+    scene(new QGraphicsScene(this)),
+    stats(stats)
+{
+    ui->setupUi(this);
+    ui->graphicsView->setScene(scene);
+
+    this->stats.flush();
+    drawTimeline();
+}
+
+TimelineWindow::~TimelineWindow()
+{
+    delete ui;
+}
+
+void TimelineWindow::drawTimeline()
+{
+    scene->clear();
+
+    const std::vector<IntervalStats::Sample> &samples = stats.samples();
+    if (samples.empty()) {
+        scene->addText("No accesses yet - run a few instructions first.");
+        return;
+    }
+
+    const int columnWidth = 40;
+    const int chartHeight = 200;
+    const size_t perColumn = (samples.size() + MAX_COLUMNS - 1) / MAX_COLUMNS;
+    const std::vector<Column> columns = mergeSamples(samples, perColumn);
+
+    QPen axisPen(Qt::black);
+    axisPen.setWidth(1);
+    QPen missPen(Qt::red);
+    missPen.setWidth(2);
+    QPen phasePen(Qt::blue);
+    phasePen.setStyle(Qt::DashLine);
+
+    int chartWidth = int(columns.size()) * columnWidth;
+
+    // Axes: y is the miss rate of each interval, 0% at the bottom
+    scene->addLine(0, 0, 0, chartHeight, axisPen);
+    scene->addLine(0, chartHeight, chartWidth, chartHeight, axisPen);
+    QGraphicsTextItem *top = scene->addText("100%");
+    top->setPos(-45, -10);
+    QGraphicsTextItem *bottom = scene->addText("0%");
+    bottom->setPos(-30, chartHeight - 10);
+
+    QPointF previous;
+    for (size_t i = 0; i < columns.size(); ++i) {
+        const Column &s = columns[i];
+        double missRate = double(s.misses) / s.accesses;
+        QPointF point(i * columnWidth + columnWidth / 2.0, chartHeight * (1.0 - missRate));
+
+        scene->addEllipse(point.x() - 3, point.y() - 3, 6, 6, missPen, QBrush(Qt::red));
+        if (i > 0)
+            scene->addLine(QLineF(previous, point), missPen);
+        previous = point;
+
+        // Mark where the working set changed
+        if (s.phaseChange) {
+            scene->addLine(i * columnWidth, 0, i * columnWidth, chartHeight, phasePen);
+            QGraphicsTextItem *label = scene->addText(QString("phase %1").arg(s.phase));
+            label->setDefaultTextColor(Qt::blue);
+            label->setScale(0.8);
+            label->setPos(i * columnWidth + 2, -20);
+        }
+
+        // Access number under each column
+        QGraphicsTextItem *x = scene->addText(QString::number(s.firstAccess));
+        x->setScale(0.7);
+        x->setPos(i * columnWidth + 4, chartHeight + 4);
+    }
+
+    QGraphicsTextItem *caption = scene->addText(
+        QString("Miss rate per interval of %1 accesses (dashed lines = phase change)")
+            .arg(qlonglong(stats.intervalLength()) * qlonglong(perColumn)));
+    caption->setPos(0, chartHeight + 30);
+
+    scene->setSceneRect(-60, -40, chartWidth + 100, chartHeight + 90);
+}
+
+void TimelineWindow::on_exportButton_clicked()
+{
+    QString path = QFileDialog::getSaveFileName(this, "Export Statistics", QString(), "CSV files (*.csv)");
+    if (path.isEmpty())
+        return;
+
+    std::string error;
+    if (!stats.exportCsv(path.toStdString(), &error))
+        QMessageBox::warning(this, "Export Statistics", QString::fromStdString(error));
+}
@@ -0,0 +1,32 @@
+#ifndef TIMELINEWINDOW_H
+#define TIMELINEWINDOW_H
+
+#include <QDialog>
+#include <QGraphicsScene>
+
+#include "IntervalStats.h"
+
+namespace Ui {
+class TimelineWindow;
+}
+
+class TimelineWindow : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit TimelineWindow(const IntervalStats &stats, QWidget *parent = nullptr);
+    ~TimelineWindow();
+
+private slots:
+    void on_exportButton_clicked();
+
+private:
+    Ui::TimelineWindow *ui;
+    QGraphicsScene *scene;
+    IntervalStats stats;   // own copy, including the unfinished interval
+
+    void drawTimeline();
+};
+
+#endif // TIMELINEWINDOW_H
@@ -0,0 +1,182 @@
+#include "TimingModel.h"
+
+#include <algorithm>
+
+namespace {
+
+// log2(value), or -1 if it isn't a power of two
+int exactLog2(int64_t value)
+{
+    if (value <= 0 || (value & (value - 1)) != 0)
+        return -1;
+    int bits = 0;
+    while ((int64_t(1) << bits) < value)
+        ++bits;
+    return bits;
+}
+
+} // namespace
+
+TimingModel::TimingModel()
+    : TimingModel(Config())
+{
+}
+
+TimingModel::TimingModel(const Config &config)
+    : m_config(config)
+{
+    // Keep the model well defined whatever the caller passed in
+    m_config.hitLatency = std::max(m_config.hitLatency, 0);
+    m_config.victimLatency = std::max(m_config.victimLatency, 0);
+    m_config.issueInterval = std::max(m_config.issueInterval, 1);
+    m_config.mshrs = std::max(m_config.mshrs, 1);
+    m_config.banks = std::max(m_config.banks, 1);
+    m_config.rowBytes = std::max(m_config.rowBytes, 1);
+    m_config.rowHitCycles = std::max(m_config.rowHitCycles, 0);
+    m_config.rowMissCycles = std::max(m_config.rowMissCycles, m_config.rowHitCycles);
+    m_config.busBytesPerCycle = std::max(m_config.busBytesPerCycle, 1);
+    if (m_config.clockGHz <= 0)
+        m_config.clockGHz = 1.0;
+    clear();
+}
+
+void TimingModel::reset(const CacheEngine &engine)
+{
+    m_blockSize = std::max(engine.blockSize(), 1);
+    m_fillBytes = std::max(engine.sectorSize(), 1);
+    clear();
+}
+
+void TimingModel::clear()
+{
+    // Row and bank from shifts and masks when every size is a power of two;
+    // the divisions would cost more than the rest of record()
+    int blockBits = exactLog2(m_blockSize);
+    m_sectorShift = exactLog2(m_fillBytes);
+    int rowBits = exactLog2(m_config.rowBytes);
+    m_bankBits = exactLog2(m_config.banks);
+    m_rowShift = (blockBits >= 0 && rowBits >= blockBits && m_bankBits >= 0) ? rowBits - blockBits : -1;
+
+    m_transferCycles = (m_fillBytes + m_config.busBytesPerCycle - 1) / m_config.busBytesPerCycle;
+    m_stats = { 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    m_now = 0;
+    m_busFree = 0;
+
+    m_banks.assign(size_t(m_config.banks), Bank{ -1, 0 });
+    m_mshrBlock.assign(size_t(m_config.mshrs), -1);
+    m_mshrSector.assign(size_t(m_config.mshrs), 0);
+    m_mshrReady.assign(size_t(m_config.mshrs), 0);
+    m_oldest = 0;
+    m_inFlight = 0;
+}
+
+void TimingModel::retire(int64_t now)
+{
+    while (m_inFlight > 0 && m_mshrReady[m_oldest] <= now) {
+        m_mshrBlock[m_oldest] = -1;
+        if (++m_oldest == m_mshrBlock.size())
+            m_oldest = 0;
+        m_inFlight--;
+    }
+}
+
+int64_t TimingModel::dramRead(int64_t blockAddress, int64_t start)
+{
+    // Consecutive rows go to consecutive banks
+    int64_t rowIndex, row;
+    size_t bankIndex;
+    if (m_rowShift >= 0) {
+        rowIndex = blockAddress >> m_rowShift;
+        bankIndex = size_t(rowIndex & (m_config.banks - 1));
+        row = rowIndex >> m_bankBits;
+    } else {
+        rowIndex = blockAddress * m_blockSize / m_config.rowBytes;
+        bankIndex = size_t(rowIndex % m_config.banks);
+        row = rowIndex / m_config.banks;
+    }
+    Bank &bank = m_banks[bankIndex];
+
+    // Open-row hit or not is a coin flip for random traffic: no branch
+    const bool rowHit = bank.openRow == row;
+    int64_t command = std::max(start, bank.ready) + (rowHit ? 0 : m_config.rowMissCycles - m_config.rowHitCycles);
+    m_stats.rowHits += rowHit;
+    m_stats.rowMisses += !rowHit;
+    bank.openRow = row;
+    bank.ready = command + m_transferCycles;
+
+    // The data then waits for the shared bus
+    int64_t busStart = std::max(command + m_config.rowHitCycles, m_busFree);
+    m_busFree = busStart + m_transferCycles;
+
+    m_stats.dramReads++;
+    m_stats.bytesRead += m_fillBytes;
+    return m_busFree;
+}
+
+int64_t TimingModel::record(const CacheEngine::AccessResult &result)
+{
+    const int64_t issue = m_now;
+    int64_t start = issue;
+    retire(start);
+
+    // A block that is still on its way can't be read before it arrives,
+    // whatever the engine (which fills instantly) says. Only blocks the
+    // engine has can be in flight; one evicted before its fill landed is
+    // simply fetched again. In a sectored cache only the missing sector is
+    // on its way: a hit on another sector doesn't wait for it, and a sector
+    // miss always needs a fetch of its own.
+    const int sector = m_sectorShift >= 0 ? result.byteOffset >> m_sectorShift : result.byteOffset / m_fillBytes;
+    int merged = -1;
+    if (m_inFlight > 0 && result.hit) {
+        for (size_t i = 0; i < m_mshrBlock.size(); ++i) {
+            if (m_mshrBlock[i] == result.blockAddress && m_mshrSector[i] == sector) {
+                merged = int(i);
+                break;
+            }
+        }
+    }
+
+    int64_t done;
+    if (merged >= 0) {
+        m_stats.mshrMerges++;
+        done = std::max(start + m_config.hitLatency, m_mshrReady[size_t(merged)]);
+    } else if (result.hit) {
+        done = start + m_config.hitLatency;
+    } else if (result.victimHit) {
+        done = start + m_config.hitLatency + m_config.victimLatency;
+    } else {
+        // No MSHR free: stall until the earliest fill lands
+        if (m_inFlight == m_mshrBlock.size()) {
+            start = m_mshrReady[m_oldest];
+            m_stats.mshrStallCycles += start - issue;
+            retire(start);
+        }
+        done = dramRead(result.blockAddress, start + m_config.hitLatency);
+
+        size_t mshr = m_oldest + m_inFlight;
+        if (mshr >= m_mshrBlock.size())
+            mshr -= m_mshrBlock.size();
+        m_mshrBlock[mshr] = result.blockAddress;
+        m_mshrSector[mshr] = sector;
+        m_mshrReady[mshr] = done;
+        m_inFlight++;
+    }
+
+    const int64_t latency = done - issue;
+    m_stats.accesses++;
+    m_stats.totalLatency += latency;
+    m_stats.cycles = std::max(m_stats.cycles, done);
+    m_now = start + m_config.issueInterval;
+    return latency;
+}
+
+double TimingModel::amat() const
+{
+    return m_stats.accesses ? double(m_stats.totalLatency) / double(m_stats.accesses) : 0.0;
+}
+
+double TimingModel::bandwidthGBs() const
+{
+    // bytes per cycle * cycles per ns = GB/s
+    return m_stats.cycles ? double(m_stats.bytesRead) / double(m_stats.cycles) * m_config.clockGHz : 0.0;
+}
@@ -0,0 +1,102 @@
+#ifndef TIMINGMODEL_H
+#define TIMINGMODEL_H
+
+#include "CacheEngine.h"
+
+#include <cstdint>
+#include <vector>
+
+// Cycle-approximate timing on top of a CacheEngine: the engine decides hit
+// or miss, this adds up what each access would cost.
+//
+// The core issues one access every issueInterval cycles and doesn't wait
+// for them (hit-under-miss). A miss needs an MSHR until its fill arrives;
+// when all MSHRs are busy the core stalls until the next one frees up.
+// Accesses to a block (or, in a sectored cache, a sector) that is still
+// being fetched join its MSHR.
+//
+// Fills go to DRAM: the address picks a bank and a row in it, an open-row
+// hit only pays the column access, anything else also closes and opens a
+// row. All banks share one data bus, which caps the bandwidth.
+//
+// Fill completion times are known as soon as the DRAM request is made, so
+// the only events are MSHR releases. Every fill ends on the one data bus,
+// so they complete in the order they were issued: the event queue is a
+// FIFO ring over the MSHRs, no heap needed.
+class TimingModel
+{
+public:
+    struct Config {
+        int hitLatency = 4;          // cycles for a cache hit
+        int victimLatency = 2;       // extra cycles to take a block back from the victim cache
+        int issueInterval = 1;       // cycles between accesses when nothing stalls
+        int mshrs = 8;               // outstanding misses; 1 = one miss at a time
+        int banks = 16;
+        int rowBytes = 8192;         // DRAM row (page) per bank
+        int rowHitCycles = 45;       // column access to an open row (CAS)
+        int rowMissCycles = 135;     // precharge + activate + CAS
+        int busBytesPerCycle = 8;    // bandwidth cap, shared by all banks
+        double clockGHz = 3.0;       // only used to report GB/s
+    };
+
+    struct Stats {
+        int64_t accesses;
+        int64_t totalLatency;        // issue to data, summed over all accesses
+        int64_t cycles;              // first issue to last completion
+        int64_t dramReads;
+        int64_t rowHits;
+        int64_t rowMisses;
+        int64_t bytesRead;
+        int64_t mshrMerges;          // accesses that joined an in-flight miss
+        int64_t mshrStallCycles;     // cycles the core waited for a free MSHR
+    };
+
+    TimingModel();
+    explicit TimingModel(const Config &config);
+
+    // Start over for this cache's block and sector size
+    void reset(const CacheEngine &engine);
+    // Start over with the same sizes
+    void clear();
+
+    // Account for one access; returns its latency in cycles
+    int64_t record(const CacheEngine::AccessResult &result);
+
+    const Config &config() const { return m_config; }
+    const Stats &stats() const { return m_stats; }
+
+    // Average memory access time in cycles
+    double amat() const;
+    // Bytes read from DRAM per second over the whole run
+    double bandwidthGBs() const;
+
+private:
+    struct Bank {
+        int64_t openRow;   // -1 = closed
+        int64_t ready;     // cycle the next column command can go out
+    };
+
+    void retire(int64_t now);
+    int64_t dramRead(int64_t blockAddress, int64_t start);
+
+    Config m_config;
+    Stats m_stats = { 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    int m_blockSize = 64;
+    int m_fillBytes = 64;        // a sector, or the whole block
+    int m_sectorShift = 6;       // log2(m_fillBytes), -1 = divide
+    int64_t m_transferCycles = 1;
+    int m_rowShift = -1;         // blocks per row as a shift, -1 = divide
+    int m_bankBits = 0;
+    int64_t m_now = 0;           // next issue cycle
+    int64_t m_busFree = 0;
+
+    std::vector<Bank> m_banks;
+    // MSHRs as a ring in completion order: m_inFlight entries from m_oldest
+    std::vector<int64_t> m_mshrBlock;   // block being fetched, -1 = free
+    std::vector<int> m_mshrSector;      // which of its sectors (0 unsectored)
+    std::vector<int64_t> m_mshrReady;   // cycle its fill lands
+    size_t m_oldest = 0;
+    size_t m_inFlight = 0;
+};
+
+#endif // TIMINGMODEL_H
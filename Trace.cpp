@@ -0,0 +1,325 @@
+#include "Trace.h"
+
+#include "CacheTrace.h"
+
+#include <cstring>
+
+namespace {
+
+bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Case-insensitive match of a lower-case keyword, advancing p on success
+bool matchWord(const char *&p, const char *end, const char *word)
+{
+    const char *q = p;
+    for (; *word; ++word, ++q) {
+        if (q == end || (*q | 0x20) != *word)
+            return false;
+    }
+    p = q;
+    return true;
+}
+
+} // namespace
+
+bool parseReadByte(const char *line, size_t length, int64_t &address)
+{
+    const char *p = line;
+    const char *end = line + length;
+
+    while (p != end && isSpace(*p)) ++p;
+    if (!matchWord(p, end, "read") || p == end || !isSpace(*p))
+        return false;
+    while (p != end && isSpace(*p)) ++p;
+    if (!matchWord(p, end, "byte") || p == end || !isSpace(*p))
+        return false;
+    while (p != end && isSpace(*p)) ++p;
+
+    // Addresses are never negative
+    if (p != end && *p == '+')
+        ++p;
+    if (p == end || *p < '0' || *p > '9')
+        return false;
+
+    // Too big for an int64_t is as malformed as a non-digit
+    int64_t value = 0;
+    while (p != end && *p >= '0' && *p <= '9') {
+        int digit = *p++ - '0';
+        if (value > (INT64_MAX - digit) / 10)
+            return false;
+        value = value * 10 + digit;
+    }
+
+    // Like the GUI, ignore extra words after the number but not "12abc"
+    if (p != end && !isSpace(*p))
+        return false;
+
+    address = value;
+    return true;
+}
+
+size_t decodeTextTrace(const char *text, size_t size, std::vector<int64_t> &out)
+{
+    size_t skipped = 0;
+    const char *p = text;
+    const char *end = text + size;
+
+    while (p < end) {
+        const char *newline = static_cast<const char *>(std::memchr(p, '\n', size_t(end - p)));
+        const char *lineEnd = newline ? newline : end;
+
+        int64_t address;
+        if (parseReadByte(p, size_t(lineEnd - p), address)) {
+            out.push_back(address);
+        } else {
+            // Only count lines that had something on them
+            const char *q = p;
+            while (q != lineEnd && isSpace(*q)) ++q;
+            if (q != lineEnd)
+                skipped++;
+        }
+        p = lineEnd + 1;
+    }
+    return skipped;
+}
+
+namespace {
+
+const size_t TEXT_CHUNK = 1 << 20;
+const size_t PACKED_CHUNK = 1 << 20;
+
+bool endsWith(const std::string &s, const char *suffix)
+{
+    size_t n = std::strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+// One LEB128 varint from [p, end); false if it runs past end or is too long
+bool getVarint(const uint8_t *&p, const uint8_t *end, uint64_t &value)
+{
+    value = 0;
+    for (int shift = 0; p != end && shift < 64; shift += 7) {
+        uint8_t byte = *p++;
+        value |= uint64_t(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+} // namespace
+
+TraceReader::~TraceReader()
+{
+    close();
+}
+
+bool TraceReader::open(const std::string &path, Format format, std::string *error)
+{
+    close();
+
+    if (format == Auto)
+        format = endsWith(path, ".bin") ? Binary : endsWith(path, ".ctr") ? Packed
+                 : endsWith(path, ".ctz") ? Compressed : Text;
+    m_format = format;
+    m_path = path;
+
+    if (format == Compressed) {
+        m_container.reset(new TraceContainerReader);
+        if (!m_container->open(path, 0, error)) {
+            m_container.reset();
+            return false;
+        }
+        return true;
+    }
+
+    m_file = std::fopen(path.c_str(), "rb");
+    if (!m_file) {
+        if (error)
+            *error = "cannot open " + path;
+        return false;
+    }
+
+    char magic[sizeof(cachesim::TRACE_MAGIC)];
+    if (format == Packed
+        && (std::fread(magic, 1, sizeof(magic), m_file) != sizeof(magic)
+            || std::memcmp(magic, cachesim::TRACE_MAGIC, sizeof(magic)) != 0)) {
+        close();
+        if (error)
+            *error = path + " is not a packed trace";
+        return false;
+    }
+    return true;
+}
+
+void TraceReader::close()
+{
+    if (m_file)
+        std::fclose(m_file);
+    m_file = nullptr;
+    m_container.reset();
+    m_path.clear();
+    m_error.clear();
+    m_failed = false;
+    m_eof = false;
+    m_skipped = 0;
+    m_text.clear();
+    m_pending.clear();
+    m_pendingPos = 0;
+    m_bytes.clear();
+    m_bytePos = 0;
+    m_previous = 0;
+}
+
+bool TraceReader::failed() const
+{
+    return m_container ? m_container->failed() : m_failed;
+}
+
+std::string TraceReader::errorMessage() const
+{
+    if (m_container)
+        return m_container->errorMessage();
+    return m_error.empty() && m_failed ? "read error in " + m_path : m_error;
+}
+
+void TraceReader::fail(const std::string &error)
+{
+    m_failed = true;
+    m_error = error;
+    m_eof = true;
+}
+
+size_t TraceReader::read(int64_t *out, size_t max)
+{
+    if (m_container)
+        return m_container->read(out, max);
+    if (!m_file || max == 0)
+        return 0;
+    switch (m_format) {
+    case Binary: return readBinary(out, max);
+    case Packed: return readPacked(out, max);
+    default: return readText(out, max);
+    }
+}
+
+size_t TraceReader::readBinary(int64_t *out, size_t max)
+{
+    size_t count = 0;
+    uint8_t buffer[8 * 4096];
+    while (count < max && !m_eof) {
+        size_t want = max - count < 4096 ? max - count : 4096;
+        // Read bytes, not records, so a partial last record can be seen
+        size_t bytes = std::fread(buffer, 1, want * 8, m_file);
+        size_t got = bytes / 8;
+        for (size_t i = 0; i < got; ++i) {
+            uint64_t v = 0;
+            for (int b = 7; b >= 0; --b)
+                v = (v << 8) | buffer[i * 8 + size_t(b)];
+            if (v >> 63) {
+                fail(m_path + ": address " + std::to_string(v) + " is 2^63 or above");
+                return count;
+            }
+            out[count++] = int64_t(v);
+        }
+        if (got < want) {
+            m_failed = std::ferror(m_file) != 0;
+            if (!m_failed && bytes % 8)
+                fail(m_path + " is truncated: " + std::to_string(bytes % 8) + " bytes after the last whole address");
+            break;
+        }
+    }
+    return count;
+}
+
+size_t TraceReader::readText(int64_t *out, size_t max)
+{
+    size_t count = 0;
+    while (count < max) {
+        // Hand out what has been decoded already
+        if (m_pendingPos < m_pending.size()) {
+            size_t n = m_pending.size() - m_pendingPos;
+            if (n > max - count)
+                n = max - count;
+            std::memcpy(out + count, m_pending.data() + m_pendingPos, n * sizeof(int64_t));
+            m_pendingPos += n;
+            count += n;
+            continue;
+        }
+        if (m_eof && m_text.empty())
+            break;
+
+        // Read another chunk and decode every complete line in it
+        if (!m_eof) {
+            size_t old = m_text.size();
+            m_text.resize(old + TEXT_CHUNK);
+            size_t got = std::fread(m_text.data() + old, 1, TEXT_CHUNK, m_file);
+            m_text.resize(old + got);
+            if (got < TEXT_CHUNK) {
+                m_eof = true;
+                m_failed = std::ferror(m_file) != 0;
+            }
+        }
+
+        size_t usable = m_text.size();
+        if (!m_eof) {
+            while (usable > 0 && m_text[usable - 1] != '\n')
+                --usable;
+        }
+        m_pending.clear();
+        m_pendingPos = 0;
+        m_skipped += decodeTextTrace(m_text.data(), usable, m_pending);
+        m_text.erase(m_text.begin(), m_text.begin() + std::ptrdiff_t(usable));
+    }
+    return count;
+}
+
+size_t TraceReader::readPacked(int64_t *out, size_t max)
+{
+    size_t count = 0;
+    while (count < max) {
+        // Keep at least one whole varint buffered unless the file is done
+        size_t left = m_bytes.size() - m_bytePos;
+        if (left < cachesim::TRACE_MAX_VARINT && !m_eof) {
+            m_bytes.erase(m_bytes.begin(), m_bytes.begin() + std::ptrdiff_t(m_bytePos));
+            m_bytePos = 0;
+            m_bytes.resize(left + PACKED_CHUNK);
+            size_t got = std::fread(m_bytes.data() + left, 1, PACKED_CHUNK, m_file);
+            m_bytes.resize(left + got);
+            if (got < PACKED_CHUNK) {
+                m_eof = true;
+                m_failed = std::ferror(m_file) != 0;
+            }
+            left = m_bytes.size();
+        }
+        if (left == 0)
+            break;
+
+        // Decode without refilling while a whole varint is sure to be there
+        const uint8_t *p = m_bytes.data() + m_bytePos;
+        const uint8_t *end = m_bytes.data() + m_bytes.size();
+        const uint8_t *safeEnd = left > cachesim::TRACE_MAX_VARINT ? end - cachesim::TRACE_MAX_VARINT : p + 1;
+        uint64_t value;
+        while (count < max && p < safeEnd) {
+            if (!getVarint(p, end, value)) {
+                fail(m_path + " is truncated or corrupt");
+                m_bytes.clear();
+                m_bytePos = 0;
+                return count;
+            }
+            m_previous = int64_t(uint64_t(m_previous) + uint64_t(cachesim::unzigzag(value)));
+            if (m_previous < 0) {
+                fail(m_path + ": address " + std::to_string(uint64_t(m_previous)) + " is 2^63 or above");
+                m_bytes.clear();
+                m_bytePos = 0;
+                return count;
+            }
+            out[count++] = m_previous;
+        }
+        m_bytePos = size_t(p - m_bytes.data());
+    }
+    return count;
+}
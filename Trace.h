@@ -0,0 +1,86 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "TraceContainer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <cstdio>
+
+// Turning trace files into byte addresses outside the GUI.
+//
+// Text traces use the format typed into the editor: one "Read Byte N"
+// per line, case-insensitive, blank lines ignored.
+// Binary traces (.bin) are plain little-endian 64-bit byte addresses.
+// Packed traces (.ctr) are delta + varint encoded, as written by
+// CacheTrace.h (see there for the layout). Compressed traces (.ctz) are
+// blocks of packed records, decompressed on worker threads (see
+// TraceContainer.h).
+
+// Parses one line. Returns false if it isn't a Read Byte instruction.
+bool parseReadByte(const char *line, size_t length, int64_t &address);
+
+// Appends the address of every valid line in text[0..size) to out and
+// returns how many non-empty lines had to be skipped.
+size_t decodeTextTrace(const char *text, size_t size, std::vector<int64_t> &out);
+
+// Streams addresses out of a trace file in chunks, so traces far bigger
+// than memory can be replayed.
+class TraceReader
+{
+public:
+    enum Format {
+        Auto,     // binary for *.bin, packed for *.ctr, compressed for *.ctz, text otherwise
+        Text,
+        Binary,
+        Packed,
+        Compressed
+    };
+
+    TraceReader() = default;
+    ~TraceReader();
+    TraceReader(const TraceReader &) = delete;
+    TraceReader &operator=(const TraceReader &) = delete;
+
+    bool open(const std::string &path, Format format = Auto, std::string *error = nullptr);
+    void close();
+
+    // Fills out[0..max) and returns how many addresses were read; 0 at the end
+    size_t read(int64_t *out, size_t max);
+
+    size_t skippedLines() const { return m_skipped; }
+    // Read error, truncation, or an address of 2^63 or above (CacheEngine
+    // takes non-negative addresses only); reading stops at the first one
+    bool failed() const;
+    std::string errorMessage() const;
+
+private:
+    FILE *m_file = nullptr;
+    std::string m_path;
+    std::string m_error;
+    Format m_format = Text;
+    bool m_failed = false;
+    bool m_eof = false;
+    size_t m_skipped = 0;
+
+    std::vector<char> m_text;        // text not decoded yet (may end mid-line)
+    std::vector<int64_t> m_pending;  // decoded, not handed out yet
+    size_t m_pendingPos = 0;
+
+    std::vector<uint8_t> m_bytes;    // packed records not decoded yet
+    size_t m_bytePos = 0;
+    int64_t m_previous = 0;          // last packed address
+
+    std::unique_ptr<TraceContainerReader> m_container;
+
+    size_t readText(int64_t *out, size_t max);
+    size_t readBinary(int64_t *out, size_t max);
+    size_t readPacked(int64_t *out, size_t max);
+    void fail(const std::string &error);
+};
+
+#endif // TRACE_H
@@ -0,0 +1,492 @@
+#include "TraceContainer.h"
+
+#include "CacheTrace.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef CACHESIM_HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef CACHESIM_HAVE_LZ4
+#include <lz4.h>
+#endif
+
+namespace {
+
+const char CONTAINER_MAGIC[8] = { 'C', 'S', 'I', 'M', 'T', 'R', 'Z', '1' };
+const uint32_t CONTAINER_VERSION = 1;
+const int ZSTD_LEVEL = 3;
+
+// On-disk header; no padding
+struct ContainerHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t codec;
+    uint64_t blocks;
+    uint64_t addresses;
+    uint64_t indexOffset;
+};
+
+bool seekTo(FILE *file, uint64_t offset)
+{
+#ifdef _WIN32
+    return _fseeki64(file, int64_t(offset), SEEK_SET) == 0;
+#else
+    return fseeko(file, off_t(offset), SEEK_SET) == 0;
+#endif
+}
+
+// Size in bytes, leaving the position at the end; false if it can't be told
+bool fileSize(FILE *file, uint64_t &size)
+{
+#ifdef _WIN32
+    if (_fseeki64(file, 0, SEEK_END) != 0)
+        return false;
+    int64_t end = _ftelli64(file);
+#else
+    if (fseeko(file, 0, SEEK_END) != 0)
+        return false;
+    int64_t end = int64_t(ftello(file));
+#endif
+    size = uint64_t(end);
+    return end >= 0;
+}
+
+void setError(std::string *error, const std::string &message)
+{
+    if (error)
+        *error = message;
+}
+
+// Worst case for compressing n bytes
+size_t compressBound(TraceCodec codec, size_t n)
+{
+    switch (codec) {
+#ifdef CACHESIM_HAVE_ZSTD
+    case CodecZstd: return ZSTD_compressBound(n);
+#endif
+#ifdef CACHESIM_HAVE_LZ4
+    case CodecLz4: return size_t(LZ4_compressBound(int(n)));
+#endif
+    default: return n;
+    }
+}
+
+// Returns the compressed size, 0 on failure
+size_t compress(TraceCodec codec, const uint8_t *src, size_t n, uint8_t *dst, [[maybe_unused]] size_t capacity)
+{
+    switch (codec) {
+#ifdef CACHESIM_HAVE_ZSTD
+    case CodecZstd: {
+        size_t r = ZSTD_compress(dst, capacity, src, n, ZSTD_LEVEL);
+        return ZSTD_isError(r) ? 0 : r;
+    }
+#endif
+#ifdef CACHESIM_HAVE_LZ4
+    case CodecLz4: {
+        int r = LZ4_compress_default(reinterpret_cast<const char *>(src), reinterpret_cast<char *>(dst), int(n), int(capacity));
+        return r > 0 ? size_t(r) : 0;
+    }
+#endif
+    default:
+        std::memcpy(dst, src, n);
+        return n;
+    }
+}
+
+// Exactly n bytes of output or false
+bool decompress(int codec, const uint8_t *src, size_t stored, uint8_t *dst, size_t n)
+{
+    switch (codec) {
+#ifdef CACHESIM_HAVE_ZSTD
+    case CodecZstd: return ZSTD_decompress(dst, n, src, stored) == n;
+#endif
+#ifdef CACHESIM_HAVE_LZ4
+    case CodecLz4:
+        return LZ4_decompress_safe(reinterpret_cast<const char *>(src), reinterpret_cast<char *>(dst), int(stored), int(n)) == int(n);
+#endif
+    case CodecNone:
+        if (stored != n)
+            return false;
+        std::memcpy(dst, src, n);
+        return true;
+    default:
+        return false;
+    }
+}
+
+} // namespace
+
+TraceCodec defaultTraceCodec()
+{
+#if defined(CACHESIM_HAVE_ZSTD)
+    return CodecZstd;
+#elif defined(CACHESIM_HAVE_LZ4)
+    return CodecLz4;
+#else
+    return CodecNone;
+#endif
+}
+
+bool traceCodecAvailable(int codec)
+{
+    switch (codec) {
+    case CodecNone: return true;
+#ifdef CACHESIM_HAVE_ZSTD
+    case CodecZstd: return true;
+#endif
+#ifdef CACHESIM_HAVE_LZ4
+    case CodecLz4: return true;
+#endif
+    default: return false;
+    }
+}
+
+const char *traceCodecName(int codec)
+{
+    switch (codec) {
+    case CodecNone: return "varint";
+    case CodecZstd: return "zstd";
+    case CodecLz4: return "lz4";
+    default: return "unknown";
+    }
+}
+
+TraceContainerWriter::~TraceContainerWriter()
+{
+    close();
+}
+
+bool TraceContainerWriter::open(const std::string &path, TraceCodec codec, std::string *error)
+{
+    close();
+    if (!traceCodecAvailable(codec)) {
+        setError(error, std::string("this build can't write ") + traceCodecName(codec));
+        return false;
+    }
+    m_file = std::fopen(path.c_str(), "wb");
+    if (!m_file) {
+        setError(error, "cannot open " + path + " for writing");
+        return false;
+    }
+    m_path = path;
+    m_codec = codec;
+    m_block.clear();
+    m_block.reserve(BLOCK_ADDRESSES);
+    m_index.clear();
+    m_addresses = 0;
+
+    // Placeholder header; close() fills in the counts and the index offset
+    ContainerHeader header;
+    std::memset(&header, 0, sizeof(header));
+    m_offset = sizeof(header);
+    if (std::fwrite(&header, sizeof(header), 1, m_file) != 1) {
+        setError(error, "short write to " + path);
+        return false;
+    }
+    return true;
+}
+
+bool TraceContainerWriter::write(const int64_t *addresses, size_t count, std::string *error)
+{
+    if (!m_file) {
+        setError(error, "no container open");
+        return false;
+    }
+    while (count > 0) {
+        size_t n = std::min(count, size_t(BLOCK_ADDRESSES) - m_block.size());
+        m_block.insert(m_block.end(), addresses, addresses + n);
+        addresses += n;
+        count -= n;
+        if (m_block.size() == BLOCK_ADDRESSES && !flushBlock(error))
+            return false;
+    }
+    return true;
+}
+
+bool TraceContainerWriter::flushBlock(std::string *error)
+{
+    if (m_block.empty())
+        return true;
+
+    int64_t previous = 0;
+    m_encoded.resize(m_block.size() * cachesim::TRACE_MAX_VARINT);
+    size_t encoded = cachesim::encodeAddresses(m_block.data(), m_block.size(), previous, m_encoded.data());
+
+    m_compressed.resize(compressBound(m_codec, encoded));
+    size_t stored = compress(m_codec, m_encoded.data(), encoded, m_compressed.data(), m_compressed.size());
+    if (stored == 0) {
+        setError(error, std::string(traceCodecName(m_codec)) + " compression failed");
+        return false;
+    }
+    if (std::fwrite(m_compressed.data(), 1, stored, m_file) != stored) {
+        setError(error, "short write to " + m_path);
+        return false;
+    }
+
+    m_index.push_back(IndexEntry{ m_offset, uint32_t(stored), uint32_t(encoded), uint32_t(m_block.size()), 0 });
+    m_offset += stored;
+    m_addresses += m_block.size();
+    m_block.clear();
+    return true;
+}
+
+bool TraceContainerWriter::close(std::string *error)
+{
+    if (!m_file)
+        return true;
+
+    bool ok = flushBlock(error);
+    ContainerHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, CONTAINER_MAGIC, sizeof(header.magic));
+    header.version = CONTAINER_VERSION;
+    header.codec = uint32_t(m_codec);
+    header.blocks = m_index.size();
+    header.addresses = m_addresses;
+    header.indexOffset = m_offset;
+
+    if (ok) {
+        ok = std::fwrite(m_index.data(), sizeof(IndexEntry), m_index.size(), m_file) == m_index.size()
+             && seekTo(m_file, 0) && std::fwrite(&header, sizeof(header), 1, m_file) == 1;
+        if (!ok)
+            setError(error, "short write to " + m_path);
+        else
+            m_offset += m_index.size() * sizeof(IndexEntry);
+    }
+    if (std::fclose(m_file) != 0 && ok) {
+        setError(error, "short write to " + m_path);
+        ok = false;
+    }
+    m_file = nullptr;
+    return ok;
+}
+
+TraceContainerReader::~TraceContainerReader()
+{
+    close();
+}
+
+bool TraceContainerReader::open(const std::string &path, int threads, std::string *error)
+{
+    close();
+
+    FILE *file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        setError(error, "cannot open " + path);
+        return false;
+    }
+
+    ContainerHeader header;
+    bool ok = std::fread(&header, sizeof(header), 1, file) == 1
+              && std::memcmp(header.magic, CONTAINER_MAGIC, sizeof(header.magic)) == 0;
+    if (!ok || header.version != CONTAINER_VERSION) {
+        std::fclose(file);
+        setError(error, path + (ok ? " has an unsupported container version" : " is not a compressed trace"));
+        return false;
+    }
+    if (!traceCodecAvailable(int(header.codec))) {
+        std::fclose(file);
+        setError(error, path + " needs " + traceCodecName(int(header.codec)) + ", which this build doesn't have");
+        return false;
+    }
+
+    // The index runs from indexOffset to the end of the file; check that
+    // before trusting the block count with an allocation
+    uint64_t size = 0;
+    ok = fileSize(file, size) && header.blocks < (uint64_t(1) << 32)
+         && header.indexOffset >= sizeof(header) && header.indexOffset <= size
+         && (size - header.indexOffset) % sizeof(IndexEntry) == 0
+         && (size - header.indexOffset) / sizeof(IndexEntry) == header.blocks;
+    if (ok) {
+        m_index.resize(size_t(header.blocks));
+        ok = seekTo(file, header.indexOffset)
+             && std::fread(m_index.data(), sizeof(IndexEntry), m_index.size(), file) == m_index.size();
+    }
+    uint64_t total = 0;
+    for (size_t i = 0; ok && i < m_index.size(); ++i) {
+        const IndexEntry &entry = m_index[i];
+        ok = entry.offset >= sizeof(header) && entry.offset + entry.storedBytes <= header.indexOffset
+             && entry.addresses > 0 && entry.addresses <= TraceContainerWriter::BLOCK_ADDRESSES
+             && entry.encodedBytes >= entry.addresses
+             && entry.encodedBytes <= uint64_t(entry.addresses) * cachesim::TRACE_MAX_VARINT;
+        total += entry.addresses;
+    }
+    std::fclose(file);
+    if (!ok || total != header.addresses) {
+        m_index.clear();
+        setError(error, path + " has a damaged block index");
+        return false;
+    }
+
+    m_path = path;
+    m_codec = int(header.codec);
+    m_totalAddresses = header.addresses;
+
+    if (threads <= 0) {
+        unsigned cores = std::thread::hardware_concurrency();
+        threads = cores > 1 ? int(cores) - 1 : 1;
+    }
+    threads = std::max(1, std::min(threads, int(m_index.size())));
+
+    // Two decoded blocks per worker: one being filled, one waiting
+    m_slots.assign(size_t(threads) * 2, Slot());
+    for (int i = 0; i < threads && !m_index.empty(); ++i)
+        m_workers.emplace_back(&TraceContainerReader::worker, this);
+    return true;
+}
+
+void TraceContainerReader::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_slotFreed.notify_all();
+    m_slotReady.notify_all();
+    for (std::thread &t : m_workers)
+        t.join();
+
+    m_workers.clear();
+    m_slots.clear();
+    m_index.clear();
+    m_totalAddresses = 0;
+    m_nextBlock = 0;
+    m_readBlock = 0;
+    m_readPos = 0;
+    m_stop = false;
+    m_failed = false;
+    m_error.clear();
+}
+
+void TraceContainerReader::fail(const std::string &error)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_failed) {
+        m_error = error;
+        m_failed = true;
+    }
+    m_stop = true;
+    m_slotReady.notify_all();
+    m_slotFreed.notify_all();
+}
+
+void TraceContainerReader::worker()
+{
+    // Each worker has its own file handle and scratch buffers
+    FILE *file = std::fopen(m_path.c_str(), "rb");
+    if (!file) {
+        fail("cannot open " + m_path);
+        return;
+    }
+    std::vector<uint8_t> stored;
+    std::vector<uint8_t> encoded;
+    std::vector<int64_t> decoded;
+
+    for (;;) {
+        size_t block;
+        {
+            // Claim the next block, but never run more than a ring ahead
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_slotFreed.wait(lock, [&] {
+                return m_stop || m_nextBlock >= m_index.size() || m_nextBlock < m_readBlock + m_slots.size();
+            });
+            if (m_stop || m_nextBlock >= m_index.size())
+                break;
+            block = m_nextBlock++;
+        }
+
+        std::string error;
+        if (!decodeBlock(file, block, stored, encoded, decoded, error)) {
+            fail(error);
+            break;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            Slot &slot = m_slots[block % m_slots.size()];
+            slot.addresses.swap(decoded);
+            slot.block = block;
+            slot.ready = true;
+        }
+        m_slotReady.notify_all();
+    }
+    std::fclose(file);
+}
+
+bool TraceContainerReader::decodeBlock(FILE *file, size_t block, std::vector<uint8_t> &stored,
+                                       std::vector<uint8_t> &encoded, std::vector<int64_t> &out,
+                                       std::string &error) const
+{
+    const IndexEntry &entry = m_index[block];
+    stored.resize(entry.storedBytes);
+    encoded.resize(entry.encodedBytes);
+    if (!seekTo(file, entry.offset) || std::fread(stored.data(), 1, stored.size(), file) != stored.size()) {
+        error = "read error in " + m_path;
+        return false;
+    }
+    if (!decompress(m_codec, stored.data(), stored.size(), encoded.data(), encoded.size())) {
+        error = m_path + ": block " + std::to_string(block) + " doesn't decompress";
+        return false;
+    }
+
+    // Same records as a packed trace, restarting from 0 in every block
+    out.resize(entry.addresses);
+    const uint8_t *p = encoded.data();
+    const uint8_t *end = p + encoded.size();
+    int64_t previous = 0;
+    for (uint32_t i = 0; i < entry.addresses; ++i) {
+        uint64_t value = 0;
+        int shift = 0;
+        for (;;) {
+            if (p == end || shift >= 64) {
+                error = m_path + ": block " + std::to_string(block) + " is corrupt";
+                return false;
+            }
+            uint8_t byte = *p++;
+            value |= uint64_t(byte & 0x7F) << shift;
+            shift += 7;
+            if (!(byte & 0x80))
+                break;
+        }
+        previous = int64_t(uint64_t(previous) + uint64_t(cachesim::unzigzag(value)));
+        if (previous < 0) {
+            error = m_path + ": block " + std::to_string(block) + " has an address of 2^63 or above";
+            return false;
+        }
+        out[i] = previous;
+    }
+    return true;
+}
+
+size_t TraceContainerReader::read(int64_t *out, size_t max)
+{
+    size_t count = 0;
+    while (count < max && m_readBlock < m_index.size()) {
+        Slot *slot = &m_slots[m_readBlock % m_slots.size()];
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_slotReady.wait(lock, [&] { return m_failed || (slot->ready && slot->block == m_readBlock); });
+            if (m_failed)
+                return count;
+        }
+
+        size_t n = std::min(max - count, slot->addresses.size() - m_readPos);
+        std::memcpy(out + count, slot->addresses.data() + m_readPos, n * sizeof(int64_t));
+        count += n;
+        m_readPos += n;
+
+        // Done with this block: hand its slot back to the workers
+        if (m_readPos == slot->addresses.size()) {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                slot->ready = false;
+                m_readBlock++;
+                m_readPos = 0;
+            }
+            m_slotFreed.notify_all();
+        }
+    }
+    return count;
+}
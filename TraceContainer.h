@@ -0,0 +1,140 @@
+#ifndef TRACECONTAINER_H
+#define TRACECONTAINER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Compressed trace files (*.ctz) for very long traces.
+//
+// Addresses are cut into blocks of BLOCK_ADDRESSES. Each block is delta +
+// varint encoded like a packed trace (starting over from 0, so blocks
+// don't depend on each other) and then compressed with zstd or LZ4 when
+// the build has them. An index of block offsets sits at the end of the file.
+//
+//   header   "CSIMTRZ1", u32 version, u32 codec, u64 blocks, u64 addresses, u64 index offset
+//   blocks   compressed bytes, back to back
+//   index    per block: u64 offset, u32 stored bytes, u32 encoded bytes, u32 addresses, u32 reserved
+//
+// Integers are little endian (native on every platform we build for).
+
+enum TraceCodec {
+    CodecNone = 0,   // delta + varint only
+    CodecZstd = 1,
+    CodecLz4 = 2
+};
+
+// Best codec this build can write, and whether it can read a given one
+TraceCodec defaultTraceCodec();
+bool traceCodecAvailable(int codec);
+const char *traceCodecName(int codec);
+
+class TraceContainerWriter
+{
+public:
+    static const uint32_t BLOCK_ADDRESSES = 1 << 16;
+
+    TraceContainerWriter() = default;
+    ~TraceContainerWriter();
+    TraceContainerWriter(const TraceContainerWriter &) = delete;
+    TraceContainerWriter &operator=(const TraceContainerWriter &) = delete;
+
+    bool open(const std::string &path, TraceCodec codec = defaultTraceCodec(), std::string *error = nullptr);
+    bool write(const int64_t *addresses, size_t count, std::string *error = nullptr);
+    // Writes the last block and the index; the file is unusable without it
+    bool close(std::string *error = nullptr);
+
+    uint64_t addresses() const { return m_addresses; }
+    uint64_t bytesWritten() const { return m_offset; }
+
+private:
+    struct IndexEntry {
+        uint64_t offset;
+        uint32_t storedBytes;
+        uint32_t encodedBytes;
+        uint32_t addresses;
+        uint32_t reserved;
+    };
+
+    bool flushBlock(std::string *error);
+
+    FILE *m_file = nullptr;
+    std::string m_path;
+    TraceCodec m_codec = CodecNone;
+    std::vector<int64_t> m_block;
+    std::vector<uint8_t> m_encoded;
+    std::vector<uint8_t> m_compressed;
+    std::vector<IndexEntry> m_index;
+    uint64_t m_addresses = 0;
+    uint64_t m_offset = 0;
+};
+
+// Reads a container with worker threads decompressing blocks ahead of the
+// reader. Blocks come out in file order through a bounded ring of decoded
+// blocks, so memory stays fixed and the consumer (the simulation) only
+// waits when the workers can't keep up.
+class TraceContainerReader
+{
+public:
+    TraceContainerReader() = default;
+    ~TraceContainerReader();
+    TraceContainerReader(const TraceContainerReader &) = delete;
+    TraceContainerReader &operator=(const TraceContainerReader &) = delete;
+
+    // threads 0 -> one per core, leaving one for the caller
+    bool open(const std::string &path, int threads = 0, std::string *error = nullptr);
+    void close();
+
+    // Same contract as TraceReader::read
+    size_t read(int64_t *out, size_t max);
+
+    bool failed() const { return m_failed.load(); }
+    const std::string &errorMessage() const { return m_error; }
+    uint64_t addresses() const { return m_totalAddresses; }
+    size_t blocks() const { return m_index.size(); }
+    int codec() const { return m_codec; }
+
+private:
+    struct IndexEntry {
+        uint64_t offset;
+        uint32_t storedBytes;
+        uint32_t encodedBytes;
+        uint32_t addresses;
+        uint32_t reserved;
+    };
+    // One decoded block in the ring
+    struct Slot {
+        std::vector<int64_t> addresses;
+        size_t block = SIZE_MAX;   // which block it holds once ready
+        bool ready = false;
+    };
+
+    void worker();
+    bool decodeBlock(FILE *file, size_t block, std::vector<uint8_t> &stored, std::vector<uint8_t> &encoded,
+                     std::vector<int64_t> &out, std::string &error) const;
+    void fail(const std::string &error);
+
+    std::string m_path;
+    int m_codec = CodecNone;
+    uint64_t m_totalAddresses = 0;
+    std::vector<IndexEntry> m_index;
+
+    std::vector<Slot> m_slots;       // block b goes to slot b % size
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_slotFreed;
+    std::condition_variable m_slotReady;
+    size_t m_nextBlock = 0;          // next block a worker claims
+    size_t m_readBlock = 0;          // block the reader is on
+    size_t m_readPos = 0;            // position inside it
+    bool m_stop = false;
+    std::atomic<bool> m_failed{ false };
+    std::string m_error;
+};
+
+#endif // TRACECONTAINER_H
@@ -0,0 +1,274 @@
+#include "WorkloadGenerator.h"
+
+#include <cmath>
+#include <cstdio>
+#include <numeric>
+
+namespace {
+
+// Larger ranges still work: the Zipf ranks are just scattered over the
+// range. The cap keeps the alias table (8 bytes per rank) in L2.
+const int64_t ZIPF_MAX_RANKS = int64_t(1) << 18;
+
+} // namespace
+
+WorkloadGenerator::WorkloadGenerator(uint64_t seed)
+    : m_state(seed ? seed : 0x9E3779B97F4A7C15ull)
+{
+}
+
+const char *WorkloadGenerator::patternName(Pattern pattern)
+{
+    switch (pattern) {
+    case Sequential:   return "Sequential";
+    case Strided:      return "Strided";
+    case Uniform:      return "Random (uniform)";
+    case Zipf:         return "Random (Zipf)";
+    case PointerChase: return "Pointer chase";
+    case MatrixTile:   return "Matrix tiling";
+    }
+    return "?";
+}
+
+uint64_t WorkloadGenerator::nextRandom()
+{
+    // xorshift64*
+    m_state ^= m_state >> 12;
+    m_state ^= m_state << 25;
+    m_state ^= m_state >> 27;
+    return m_state * 0x2545F4914F6CDD1Dull;
+}
+
+uint64_t WorkloadGenerator::nextBelow(uint64_t bound)
+{
+    // Multiply-shift instead of a modulo for the common 32-bit case
+    if (bound <= 0xFFFFFFFFull)
+        return ((nextRandom() >> 32) * bound) >> 32;
+    return nextRandom() % bound;
+}
+
+void WorkloadGenerator::add(const Config &config, double weight)
+{
+    Component c;
+    c.config = config;
+    c.config.elementSize = config.elementSize > 0 ? config.elementSize : 1;
+    c.config.size = config.size > 0 ? config.size : 1;
+    c.weight = weight > 0.0 ? weight : 0.0;
+    c.elements = c.config.size / c.config.elementSize;
+    if (c.elements < 1)
+        c.elements = 1;
+    c.cursor = 0;
+    c.scatter = 1;
+    c.chaseMask = 0;
+    c.chaseShift = 1;
+
+    if (c.config.pattern == MatrixTile) {
+        // The matrix decides the range; tiles must divide it evenly
+        if (c.config.matrixDim < 1)
+            c.config.matrixDim = 1;
+        int t = c.config.tileDim;
+        if (t < 1 || t > c.config.matrixDim)
+            t = c.config.matrixDim;
+        while (c.config.matrixDim % t != 0)
+            --t;
+        c.config.tileDim = t;
+    } else if (c.config.pattern == Zipf) {
+        buildZipf(c);
+    } else if (c.config.pattern == PointerChase) {
+        // The list is never stored: node i of the chain is a fixed random
+        // permutation of i over the next power of two, with nodes past the
+        // end of the range skipped. Same single cycle, no memory.
+        int bits = 1;
+        while ((uint64_t(1) << bits) < uint64_t(c.elements))
+            ++bits;
+        c.chaseMask = (uint64_t(1) << bits) - 1;
+        c.chaseShift = bits / 2 > 0 ? bits / 2 : 1;
+        c.scatter = nextRandom() | 1;   // odd multiplier, picks the permutation
+    }
+
+    m_totalWeight += c.weight;
+    m_components.push_back(std::move(c));
+}
+
+void WorkloadGenerator::buildZipf(Component &c)
+{
+    int64_t ranks = c.elements < ZIPF_MAX_RANKS ? c.elements : ZIPF_MAX_RANKS;
+
+    // Vose's alias method: one random number and one compare per address
+    std::vector<double> p(static_cast<size_t>(ranks));
+    double sum = 0.0;
+    for (int64_t k = 0; k < ranks; ++k) {
+        p[size_t(k)] = 1.0 / std::pow(double(k + 1), c.config.zipfExponent);
+        sum += p[size_t(k)];
+    }
+
+    c.zipfTable.assign(size_t(ranks), AliasEntry{ 0xFFFFFFFFu, 0 });
+    std::vector<uint32_t> small, large;
+    for (int64_t k = 0; k < ranks; ++k) {
+        p[size_t(k)] = p[size_t(k)] * ranks / sum;
+        (p[size_t(k)] < 1.0 ? small : large).push_back(uint32_t(k));
+    }
+    while (!small.empty() && !large.empty()) {
+        uint32_t s = small.back();
+        small.pop_back();
+        uint32_t l = large.back();
+        c.zipfTable[s].threshold = uint32_t(p[s] * 4294967295.0);
+        c.zipfTable[s].alias = l;
+        p[l] -= 1.0 - p[s];
+        if (p[l] < 1.0) {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+
+    // Spread the hot ranks over the range instead of packing them together
+    uint64_t scatter = 0x9E3779B1ull % uint64_t(c.elements);
+    if (scatter == 0)
+        scatter = 1;
+    while (std::gcd(scatter, uint64_t(c.elements)) != 1)
+        ++scatter;
+    c.scatter = scatter;
+}
+
+void WorkloadGenerator::fill(Component &c, int64_t *out, size_t count)
+{
+    const Config &cfg = c.config;
+    const int64_t base = cfg.base;
+    const int64_t element = cfg.elementSize;
+
+    switch (cfg.pattern) {
+    case Sequential: {
+        int64_t cursor = c.cursor;
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = base + cursor * element;
+            if (++cursor == c.elements)
+                cursor = 0;
+        }
+        c.cursor = cursor;
+        break;
+    }
+    case Strided: {
+        int64_t cursor = c.cursor;
+        int64_t stride = cfg.stride % cfg.size;
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = base + cursor;
+            cursor += stride;
+            if (cursor >= cfg.size)
+                cursor -= cfg.size;
+        }
+        c.cursor = cursor;
+        break;
+    }
+    case Uniform:
+        for (size_t i = 0; i < count; ++i)
+            out[i] = base + int64_t(nextBelow(uint64_t(c.elements))) * element;
+        break;
+    case Zipf: {
+        const uint64_t ranks = c.zipfTable.size();
+        const uint64_t elements = uint64_t(c.elements);
+        const bool powerOfTwo = (elements & (elements - 1)) == 0;
+        for (size_t i = 0; i < count; ++i) {
+            uint64_t r = nextRandom();
+            uint64_t rank = ((r >> 32) * ranks) >> 32;
+            const AliasEntry &entry = c.zipfTable[rank];
+            if (uint32_t(r) > entry.threshold)
+                rank = entry.alias;
+            uint64_t scattered = rank * c.scatter;
+            out[i] = base + int64_t(powerOfTwo ? (scattered & (elements - 1)) : (scattered % elements)) * element;
+        }
+        break;
+    }
+    case PointerChase: {
+        // xorshift and odd multiply are both bijections on [0, 2^bits)
+        uint64_t counter = uint64_t(c.cursor);
+        const uint64_t elements = uint64_t(c.elements);
+        const uint64_t mask = c.chaseMask;
+        const int shift = c.chaseShift;
+        for (size_t i = 0; i < count; ++i) {
+            uint64_t node;
+            do {
+                node = counter;
+                counter = (counter + 1) & mask;
+                node ^= node >> shift;
+                node = (node * c.scatter) & mask;
+                node ^= node >> shift;
+                node = (node * 0x9E3779B97F4A7C15ull) & mask;
+                node ^= node >> shift;
+            } while (node >= elements);
+            out[i] = base + int64_t(node) * element;
+        }
+        c.cursor = int64_t(counter);
+        break;
+    }
+    case MatrixTile: {
+        const int64_t dim = cfg.matrixDim;
+        const int64_t t = cfg.tileDim;
+        const int64_t tilesPerRow = dim / t;
+
+        // Decode the position once, then step the four loop counters
+        int64_t cursor = c.cursor;
+        int64_t j = cursor % t;
+        int64_t i = (cursor / t) % t;
+        int64_t tj = (cursor / (t * t)) % tilesPerRow;
+        int64_t ti = cursor / (t * t * tilesPerRow);
+        for (size_t n = 0; n < count; ++n) {
+            out[n] = base + ((ti * t + i) * dim + tj * t + j) * element;
+            if (++j == t) {
+                j = 0;
+                if (++i == t) {
+                    i = 0;
+                    if (++tj == tilesPerRow) {
+                        tj = 0;
+                        if (++ti == tilesPerRow)
+                            ti = 0;
+                    }
+                }
+            }
+        }
+        c.cursor = ((ti * tilesPerRow + tj) * t + i) * t + j;
+        break;
+    }
+    }
+}
+
+void WorkloadGenerator::generate(int64_t *out, size_t count)
+{
+    if (m_components.empty()) {
+        for (size_t i = 0; i < count; ++i)
+            out[i] = 0;
+        return;
+    }
+    if (m_components.size() == 1) {
+        fill(m_components[0], out, count);
+        return;
+    }
+
+    // Mix: pick a component by weight for every burst
+    size_t done = 0;
+    while (done < count) {
+        double pick = double(nextRandom() >> 11) * (1.0 / 9007199254740992.0) * m_totalWeight;
+        size_t which = 0;
+        while (which + 1 < m_components.size() && pick >= m_components[which].weight) {
+            pick -= m_components[which].weight;
+            ++which;
+        }
+        size_t burst = count - done < size_t(MIX_BURST) ? count - done : size_t(MIX_BURST);
+        fill(m_components[which], out + done, burst);
+        done += burst;
+    }
+}
+
+std::string WorkloadGenerator::generateText(size_t count)
+{
+    std::vector<int64_t> addresses(count);
+    generate(addresses.data(), count);
+
+    std::string text;
+    text.reserve(count * 16);
+    char line[40];
+    for (int64_t address : addresses) {
+        int n = std::snprintf(line, sizeof(line), "Read Byte %lld\n", static_cast<long long>(address));
+        text.append(line, size_t(n));
+    }
+    return text;
+}
@@ -0,0 +1,81 @@
+#ifndef WORKLOADGENERATOR_H
+#define WORKLOADGENERATOR_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Synthetic byte-address streams, either as "Read Byte N" text for the
+// editor or as plain address chunks that go straight into CacheEngine.
+//
+// A generator holds one or more patterns. With a single pattern it just
+// produces that one; with several it is a mix that switches to a randomly
+// picked (weighted) pattern every MIX_BURST addresses. generate() runs one
+// tight loop per pattern and burst, which is what keeps it fast enough to
+// drive the engine in benchmarks.
+class WorkloadGenerator
+{
+public:
+    enum Pattern {
+        Sequential,    // base, base + element, base + 2*element, ... wrapping
+        Strided,       // base, base + stride, ... wrapping
+        Uniform,       // uniformly random element
+        Zipf,          // a few hot elements, a long cold tail
+        PointerChase,  // follows a random cyclic linked list through the range
+        MatrixTile     // row-major matrix walked tile by tile
+    };
+
+    struct Config {
+        Pattern pattern = Sequential;
+        int64_t base = 0;            // first byte of the address range
+        int64_t size = 1024;         // bytes in the range
+        int elementSize = 1;         // bytes per element / list node / matrix entry
+        int64_t stride = 64;         // Strided only
+        double zipfExponent = 1.0;   // Zipf only
+        int matrixDim = 16;          // MatrixTile: the matrix is dim x dim elements
+        int tileDim = 4;             // MatrixTile: tiles are tile x tile elements
+    };
+
+    static const int MIX_BURST = 64;
+
+    explicit WorkloadGenerator(uint64_t seed = 1);
+
+    // Add a pattern; with more than one the output is a weighted mix
+    void add(const Config &config, double weight = 1.0);
+
+    // Fill out[0..count) with byte addresses
+    void generate(int64_t *out, size_t count);
+
+    // The same addresses as "Read Byte N" lines, one per address
+    std::string generateText(size_t count);
+
+    static const char *patternName(Pattern pattern);
+
+private:
+    struct AliasEntry {
+        uint32_t threshold;   // keep the rank when the random word is below this
+        uint32_t alias;       // otherwise take this one
+    };
+
+    struct Component {
+        Config config;
+        double weight;
+        int64_t elements;            // size / elementSize
+        int64_t cursor;              // Sequential, Strided, PointerChase, MatrixTile
+        std::vector<AliasEntry> zipfTable;
+        uint64_t scatter;            // Zipf: rank -> element multiplier (coprime to elements)
+        uint64_t chaseMask;          // PointerChase: 2^bits - 1, smallest power of two >= elements
+        int chaseShift;              // PointerChase: bits / 2
+    };
+
+    std::vector<Component> m_components;
+    uint64_t m_state;
+    double m_totalWeight = 0.0;
+
+    uint64_t nextRandom();
+    uint64_t nextBelow(uint64_t bound);
+    void fill(Component &c, int64_t *out, size_t count);
+    void buildZipf(Component &c);
+};
+
+#endif // WORKLOADGENERATOR_H
@@ -1,11 +1,26 @@
 #include "mainwindow.h"
 #include "./ui_mainwindow.h"
+#include "CompareWindow.h"
 #include "MemoryWindow.h"
+#include "TimelineWindow.h"
+#include "WorkloadGenerator.h"
 
+#include <QDateTime>
+#include <QFileDialog>
 #include <QGraphicsRectItem>
 #include <QGraphicsTextItem>
+#include <QInputDialog>
+#include <cstdint>
 #include <cmath>
 #include <iostream>
+#include <memory>
+
+namespace {
+
+// Lines between the snapshots Previous Step and Jump go back to
+const int STEP_CHECKPOINT_INTERVAL = 1024;
+
+} // namespace
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -35,6 +50,18 @@ MainWindow::MainWindow(QWidget *parent)
     ui->replacement->addItem("LRU", QVariant(5));
     ui->replacement->addItem("FIFO", QVariant(6));
 
+    // populate set index function
+    ui->indexFunction->addItem("Modulo (block mod sets)", QVariant(CacheEngine::Modulo));
+    ui->indexFunction->addItem("XOR-fold", QVariant(CacheEngine::XorFold));
+    ui->indexFunction->addItem("Prime modulo", QVariant(CacheEngine::PrimeModulo));
+    ui->indexFunction->addItem("Skewed (hash per way)", QVariant(CacheEngine::Skewed));
+
+    // populate victim cache size (entries)
+    ui->victimCache->addItem("None", QVariant(0));
+    ui->victimCache->addItem("1 entry", QVariant(1));
+    ui->victimCache->addItem("2 entries", QVariant(2));
+    ui->victimCache->addItem("4 entries", QVariant(4));
+
     // Initially disable Start Simulation button
     ui->startsimulation->setEnabled(false);
 
@@ -46,10 +73,18 @@ MainWindow::MainWindow(QWidget *parent)
     connect(ui->blocksize, &QComboBox::currentTextChanged,
             this, &MainWindow::checkInputsReady);
 
+    // Parsed instructions go stale as soon as the editor changes
+    connect(ui->textEdit, &QTextEdit::textChanged,
+            this, &MainWindow::invalidateInstructions);
+
 }
 
 MainWindow::~MainWindow()
 {
+    if (compareThread) {
+        compareThread->wait();
+        delete compareThread;
+    }
     delete ui;
 }
 
@@ -79,13 +114,19 @@ void MainWindow::on_startsimulation_clicked()
                 .arg(cacheSize).arg(blockSize).arg(numofblocks)
             );
     }
-    // Store current configuration
-    currentBlockSize = blockSize;
-    currentCacheSize = cacheSize;
-    currentAssociativity = associativity;
-    int currentReplacementPolicy = ui->replacement->currentData().toInt();
+    // Store current configuration (this also resets the cache)
+    engine.setIndexFunction(ui->indexFunction->currentData().toInt());
+    engine.setVictimCache(ui->victimCache->currentData().toInt());
+    engine.configure(cacheSize, blockSize, rawAssoc, ui->replacement->currentData().toInt());
+    if (engine.indexFunction() != ui->indexFunction->currentData().toInt()) {
+        ui->textBrowser->append("Note: with a single set there is nothing to hash, using plain modulo indexing");
+        ui->indexFunction->setCurrentIndex(ui->indexFunction->findData(engine.indexFunction()));
+    }
+    engine.loadHexMemory(mockData);
+    intervalStats.clear();
+    timing.reset(engine);
     currentInstructionLine = 0;
-    accessCounter = 0;
+    resetStepCheckpoints();
 
     // If valid, proceed to open MemoryWindow
     MemoryWindow *mw = new MemoryWindow(blockSize, this);
@@ -137,20 +178,6 @@ void MainWindow::drawDirectMapped(int cacheSize, int blockSize)
     // Number of sets = cacheSize / blockSize
     int numSets = cacheSize / blockSize;
 
-    // Initialize cache structure: numSets rows, 1 way each
-    cache.clear();
-    cache.resize(numSets);
-    for (int set = 0; set < numSets; ++set) {
-        cache[set].resize(1); // 1 way per set
-        // Initialize the cache line
-        cache[set][0].tag = "";
-        cache[set][0].data.resize(blockSize);
-        cache[set][0].data.fill(0);
-        cache[set][0].lineIndex = 0;
-        cache[set][0].lastaccess = -1;
-        cache[set][0].firstaccess = -1;
-    }
-
     // Create a scene if not already present
     if (!cacheScene) {
         cacheScene = new QGraphicsScene(this);
@@ -209,21 +236,6 @@ void MainWindow::drawTwoWay(int cacheSize, int blockSize)
     int numSets = cacheSize / blockSize / 2; // 2 ways
     int numWays = 2;
 
-    // Initialize cache structure: numSets rows, 2 ways each
-    cache.clear();
-    cache.resize(numSets);
-    for (int set = 0; set < numSets; ++set) {
-        cache[set].resize(numWays);
-        for (int way = 0; way < numWays; ++way) {
-            cache[set][way].tag = "";
-            cache[set][way].data.resize(blockSize);
-            cache[set][way].data.fill(0);
-            cache[set][way].lineIndex = way;
-            cache[set][way].lastaccess = -1;
-            cache[set][way].firstaccess = -1;
-        }
-    }
-
     if (!cacheScene) {
         cacheScene = new QGraphicsScene(this);
         ui->cacheView->setScene(cacheScene);
@@ -286,21 +298,6 @@ void MainWindow::drawFourWay(int cacheSize, int blockSize)
     int numSets = cacheSize / blockSize / 4; // 4 ways
     int numWays = 4;
 
-    // Initialize cache structure: numSets rows, 4 ways each
-    cache.clear();
-    cache.resize(numSets);
-    for (int set = 0; set < numSets; ++set) {
-        cache[set].resize(numWays);
-        for (int way = 0; way < numWays; ++way) {
-            cache[set][way].tag = "";
-            cache[set][way].data.resize(blockSize);
-            cache[set][way].data.fill(0);
-            cache[set][way].lineIndex = way;
-            cache[set][way].lastaccess = -1;
-            cache[set][way].firstaccess = -1;
-        }
-    }
-
     if (!cacheScene) {
         cacheScene = new QGraphicsScene(this);
         ui->cacheView->setScene(cacheScene);
@@ -361,20 +358,6 @@ void MainWindow::drawFullyAssociative(int cacheSize, int blockSize)
 {
     // Fully associative: 1 set, all blocks as rows
     int numBlocks = cacheSize / blockSize;
-    int numSets = 1;
-
-    // Initialize cache structure: 1 set, numBlocks ways
-    cache.clear();
-    cache.resize(numSets);
-    cache[0].resize(numBlocks);
-    for (int way = 0; way < numBlocks; ++way) {
-        cache[0][way].tag = "";
-        cache[0][way].data.resize(blockSize);
-        cache[0][way].data.fill(0);
-        cache[0][way].lineIndex = way;
-        cache[0][way].lastaccess = -1;
-        cache[0][way].firstaccess = -1;
-    }
 
     if (!cacheScene) {
         cacheScene = new QGraphicsScene(this);
@@ -429,46 +412,185 @@ void MainWindow::drawFullyAssociative(int cacheSize, int blockSize)
 
 void MainWindow::on_nextStep_clicked()
 {
-    // Get the text from textEdit
-    QString allText = ui->textEdit->toPlainText();
-    QStringList instructions = allText.split('\n', Qt::SkipEmptyParts);
+    if (engine.numWays() == 0) {
+        ui->textBrowser->append("Please start the simulation first.");
+        return;
+    }
+
+    parseInstructions();
 
     // Check if we have more instructions to execute
-    if (currentInstructionLine >= instructions.size()) {
+    if (currentInstructionLine >= instructionLines.size()) {
         ui->textBrowser->append("\n========================================");
         ui->textBrowser->append("All instructions completed!");
         ui->textBrowser->append("========================================\n");
         return;
     }
 
+    explainInstruction(currentInstructionLine);
+}
+
+void MainWindow::on_previousStep_clicked()
+{
+    if (engine.numWays() == 0) {
+        ui->textBrowser->append("Please start the simulation first.");
+        return;
+    }
+    if (currentInstructionLine <= 1) {
+        ui->textBrowser->append("Already at the first instruction.");
+        return;
+    }
+
+    parseInstructions();
+    // Show the one before the instruction on screen
+    goToInstruction(currentInstructionLine - 2);
+}
+
+void MainWindow::on_jumpToInstruction_clicked()
+{
+    if (engine.numWays() == 0) {
+        ui->textBrowser->append("Please start the simulation first.");
+        return;
+    }
+
+    parseInstructions();
+    if (instructionLines.isEmpty()) {
+        ui->textBrowser->append("There are no instructions to jump to.");
+        return;
+    }
+
+    bool ok = false;
+    int count = instructionLines.size();
+    int number = QInputDialog::getInt(this, "Jump to instruction", QString("Instruction (1 to %1):").arg(count),
+                                      qMin(currentInstructionLine + 1, count), 1, count, 1, &ok);
+    if (!ok)
+        return;
+    goToInstruction(number - 1);
+}
+
+void MainWindow::invalidateInstructions()
+{
+    instructionsParsed = false;
+    // Snapshots after the start were taken with the old instructions
+    if (stepCheckpoints.size() > 1)
+        stepCheckpoints.resize(1);
+}
+
+void MainWindow::parseInstructions()
+{
+    if (instructionsParsed)
+        return;
+
+    instructionLines = ui->textEdit->toPlainText().split('\n', Qt::SkipEmptyParts);
+    instructionAddresses.resize(instructionLines.size());
+    for (int i = 0; i < instructionLines.size(); ++i) {
+        instructionLines[i] = instructionLines[i].trimmed();
+        QStringList parts = instructionLines[i].split(' ', Qt::SkipEmptyParts);
+        if (parts.size() < 3 || parts[0].toLower() != "read" || parts[1].toLower() != "byte")
+            instructionAddresses[i] = INT64_MIN;
+        else
+            instructionAddresses[i] = parts[2].toInt();
+    }
+    instructionsParsed = true;
+}
+
+void MainWindow::resetStepCheckpoints()
+{
+    stepCheckpoints.clear();
+    stepCheckpoints.append(StepCheckpoint{ currentInstructionLine, engine, intervalStats, timing });
+    emit currentInstructionChanged(currentInstructionLine);
+}
+
+void MainWindow::saveStepCheckpoint()
+{
+    if (currentInstructionLine % STEP_CHECKPOINT_INTERVAL == 0
+        && (stepCheckpoints.isEmpty() || stepCheckpoints.last().line < currentInstructionLine))
+        stepCheckpoints.append(StepCheckpoint{ currentInstructionLine, engine, intervalStats, timing });
+}
+
+// Runs lines up to endLine through the cache without explaining or drawing anything
+void MainWindow::runInstructionsSilently(int endLine)
+{
+    while (currentInstructionLine < endLine) {
+        saveStepCheckpoint();
+        int64_t address = instructionAddresses[currentInstructionLine];
+        if (address >= 0) {
+            CacheEngine::AccessResult result = engine.access(address);
+            intervalStats.record(result);
+            timing.record(result);
+        }
+        currentInstructionLine++;
+    }
+}
+
+// Puts the cache in the state right before line and explains that one step
+void MainWindow::goToInstruction(int line)
+{
+    if (line >= instructionLines.size()) {
+        ui->textBrowser->append(QString("There is no instruction %1 any more (the editor has %2).")
+                                    .arg(line + 1).arg(instructionLines.size()));
+        return;
+    }
+    if (line < currentInstructionLine && !stepCheckpoints.isEmpty()) {
+        int i = stepCheckpoints.size() - 1;
+        while (i > 0 && stepCheckpoints[i].line > line)
+            --i;
+        const StepCheckpoint &checkpoint = stepCheckpoints[i];
+        engine = checkpoint.engine;
+        intervalStats = checkpoint.intervalStats;
+        timing = checkpoint.timing;
+        currentInstructionLine = checkpoint.line;
+    }
+
+    int skipped = line - currentInstructionLine;
+    runInstructionsSilently(line);
+    if (skipped > 0)
+        ui->textBrowser->append(QString("\n(Ran %1 instructions without explanation to get to instruction %2)")
+                                    .arg(skipped).arg(line + 1));
+    explainInstruction(line);
+
+    // A bad line stops the explanation before the redraw, but the cache may have moved
+    if (instructionAddresses[line] < 0)
+        updateCacheVisualization();
+}
+
+void MainWindow::explainInstruction(int line)
+{
+    saveStepCheckpoint();
+
     // Get current instruction
-    QString instruction = instructions[currentInstructionLine].trimmed();
-    currentInstructionLine++;
+    QString instruction = instructionLines[line];
+    currentInstructionLine = line + 1;
+    emit currentInstructionChanged(currentInstructionLine);
 
     ui->textBrowser->append("\n========================================");
     ui->textBrowser->append(QString("INSTRUCTION %1: %2").arg(currentInstructionLine).arg(instruction));
     ui->textBrowser->append("========================================");
 
-    // Parse instruction: "Read Byte 19"
-    QStringList parts = instruction.split(' ', Qt::SkipEmptyParts);
-    if (parts.size() < 3 || parts[0].toLower() != "read" || parts[1].toLower() != "byte") {
+    // Parsed by parseInstructions(): "Read Byte 19"
+    if (instructionAddresses[line] == INT64_MIN) {
         ui->textBrowser->append(QString("ERROR: Invalid instruction format: %1").arg(instruction));
         ui->textBrowser->append("Expected format: Read Byte <number>");
         return;
     }
 
-    int byteAddress = parts[2].toInt();
+    int byteAddress = int(instructionAddresses[line]);
+    if (byteAddress < 0) {
+        ui->textBrowser->append(QString("ERROR: Byte address must not be negative: %1").arg(byteAddress));
+        return;
+    }
+    int blockSize = engine.blockSize();
 
     // Step 1: Address Breakdown
     ui->textBrowser->append("\n--- STEP 1: ADDRESS ANALYSIS ---");
     ui->textBrowser->append(QString("Requested byte address: %1 (decimal)").arg(byteAddress));
 
     // Calculate block address
-    int blockAddress = byteAddress / currentBlockSize;
-    int byteOffset = byteAddress % currentBlockSize;
+    int blockAddress = byteAddress / blockSize;
+    int byteOffset = byteAddress % blockSize;
 
-    int offsetBits = static_cast<int>(std::log2(currentBlockSize));
-    int numSets = cache.size();
+    int offsetBits = static_cast<int>(std::log2(blockSize));
+    int numSets = engine.numSets();
     int indexBits = (numSets > 1) ? static_cast<int>(std::log2(numSets)) : 0;
 
     // Convert byte address to binary
@@ -480,20 +602,20 @@ void MainWindow::on_nextStep_clicked()
 
     // Step 2: Calculate which block contains this byte
     ui->textBrowser->append(QString("\n--- STEP 2: BLOCK IDENTIFICATION ---"));
-    ui->textBrowser->append(QString("Block size: %1 bytes").arg(currentBlockSize));
+    ui->textBrowser->append(QString("Block size: %1 bytes").arg(blockSize));
     ui->textBrowser->append(QString("Block address calculation: %1 ÷ %2 = %3")
-                                .arg(byteAddress).arg(currentBlockSize).arg(blockAddress));
+                                .arg(byteAddress).arg(blockSize).arg(blockAddress));
     ui->textBrowser->append(QString("  - Byte %1 is located in Block %2").arg(byteAddress).arg(blockAddress));
     ui->textBrowser->append(QString("  - Block %1 contains bytes %2 through %3")
                                 .arg(blockAddress)
-                                .arg(blockAddress * currentBlockSize)
-                                .arg((blockAddress + 1) * currentBlockSize - 1));
+                                .arg(blockAddress * blockSize)
+                                .arg((blockAddress + 1) * blockSize - 1));
 
     // Step 3: Calculate set index and tag
     ui->textBrowser->append(QString("\n--- STEP 3: CACHE ADDRESS MAPPING ---"));
 
-    int setIndex = blockAddress % numSets;
-    int tag = blockAddress / numSets;
+    int setIndex = engine.setIndexOf(blockAddress);
+    int tag = static_cast<int>(engine.tagOf(blockAddress));
 
     QString offsetBin = QString("%1").arg(byteOffset, offsetBits, 2, QLatin1Char('0'));
     QString setBin = (indexBits > 0) ? QString("%1").arg(setIndex, indexBits, 2, QLatin1Char('0')) : "";
@@ -501,17 +623,56 @@ void MainWindow::on_nextStep_clicked()
 
     ui->textBrowser->append(QString("Number of sets in cache: %1").arg(numSets));
 
-    if (numSets > 1) {
+    const bool skewed = engine.indexFunction() == CacheEngine::Skewed;
+    if (numSets == 1) {
+        ui->textBrowser->append(QString("  - Fully associative cache: only 1 set (Set 0)"));
+    } else if (engine.indexFunction() == CacheEngine::XorFold) {
+        // Every indexBits-wide chunk of the block address, lowest first
+        QStringList chunks;
+        for (int rest = blockAddress;; rest >>= indexBits) {
+            chunks << QString("%1").arg(rest & (numSets - 1), indexBits, 2, QLatin1Char('0'));
+            if ((rest >> indexBits) == 0)
+                break;
+        }
+        ui->textBrowser->append(QString("Set index calculation (XOR-fold): cut block %1 into %2-bit pieces and XOR them")
+                                    .arg(blockAddress).arg(indexBits));
+        ui->textBrowser->append(QString("  %1 = %2").arg(chunks.join(" XOR ")).arg(setBin));
+        ui->textBrowser->append(QString("  - Block %1 maps to Set %2 (binary: %3)")
+                                    .arg(blockAddress).arg(setIndex).arg(setBin));
+        ui->textBrowser->append("  - The upper bits take part too, so power-of-two strides no longer pile into one set");
+    } else if (engine.indexFunction() == CacheEngine::PrimeModulo) {
+        ui->textBrowser->append(QString("Set index calculation (prime modulo): %1 mod %2 = %3")
+                                    .arg(blockAddress).arg(engine.indexedSets()).arg(setIndex));
+        if (engine.indexedSets() < numSets) {
+            ui->textBrowser->append(QString("  - %1 is the largest prime <= %2, so Sets %1 to %3 are never used")
+                                        .arg(engine.indexedSets()).arg(numSets).arg(numSets - 1));
+        }
+        ui->textBrowser->append(QString("  - Block %1 maps to Set %2 (binary: %3)")
+                                    .arg(blockAddress).arg(setIndex).arg(setBin));
+    } else if (skewed) {
+        int low = blockAddress & (numSets - 1);
+        int high = (blockAddress >> indexBits) & (numSets - 1);
+        ui->textBrowser->append("Set index calculation (skewed): every way has its own hash");
+        ui->textBrowser->append(QString("  - Low %1 bits: %2, next %1 bits: %3")
+                                    .arg(indexBits)
+                                    .arg(low, indexBits, 2, QLatin1Char('0'))
+                                    .arg(high, indexBits, 2, QLatin1Char('0')));
+        ui->textBrowser->append("  - Way w uses: low bits XOR (next bits rotated left by w)");
+        for (int way = 0; way < engine.numWays(); ++way) {
+            int waySet = engine.setIndexOf(blockAddress, way);
+            ui->textBrowser->append(QString("  - Way %1 -> Set %2 (binary: %3)")
+                                        .arg(way).arg(waySet).arg(waySet, indexBits, 2, QLatin1Char('0')));
+        }
+        ui->textBrowser->append("  - Blocks that collide in one way usually don't in the others");
+    } else {
         ui->textBrowser->append(QString("Set index calculation: %1 mod %2 = %3")
                                     .arg(blockAddress).arg(numSets).arg(setIndex));
         ui->textBrowser->append(QString("  - Block %1 maps to Set %2 (binary: %3)")
                                     .arg(blockAddress).arg(setIndex).arg(setBin));
-    } else {
-        ui->textBrowser->append(QString("  - Fully associative cache: only 1 set (Set 0)"));
     }
 
     ui->textBrowser->append(QString("Tag calculation: %1 ÷ %2 = %3")
-                                .arg(blockAddress).arg(numSets).arg(tag));
+                                .arg(blockAddress).arg(engine.indexedSets()).arg(tag));
     ui->textBrowser->append(QString("  - Tag value: %1 (binary: %2)").arg(tag).arg(tagBin));
     ui->textBrowser->append(QString("  - The tag uniquely identifies which block is stored in this set"));
 
@@ -533,184 +694,162 @@ void MainWindow::on_nextStep_clicked()
 
     // Step 4: Cache lookup
     ui->textBrowser->append(QString("\n--- STEP 4: CACHE LOOKUP ---"));
-    ui->textBrowser->append(QString("Searching Set %1 for Tag %2...").arg(setIndex).arg(tag));
-    ui->textBrowser->append(QString("Set %1 has %2 way(s):").arg(setIndex).arg(cache[setIndex].size()));
-
-    bool hit = false;
-    int hitWay = -1;
-    QString tagStr = QString::number(tag);
+    if (skewed) {
+        ui->textBrowser->append(QString("Searching each way in its own set for Tag %1...").arg(tag));
+    } else {
+        ui->textBrowser->append(QString("Searching Set %1 for Tag %2...").arg(setIndex).arg(tag));
+        ui->textBrowser->append(QString("Set %1 has %2 way(s):").arg(setIndex).arg(engine.numWays()));
+    }
 
-    // Display current state of the set
-    for (int way = 0; way < cache[setIndex].size(); ++way) {
-        if (cache[setIndex][way].tag.isEmpty()) {
-            ui->textBrowser->append(QString("  Way %1: [EMPTY]").arg(way));
+    // Keep a copy of the candidate lines as they were before the access, for the explanation below
+    QVector<CacheEngine::Line> before;
+    for (int way = 0; way < engine.numWays(); ++way) {
+        const CacheEngine::Line &line = engine.line(engine.setIndexOf(blockAddress, way), way);
+        before.append(line);
+        QString wayName = skewed ? QString("Way %1 (Set %2)").arg(way).arg(engine.setIndexOf(blockAddress, way))
+                                 : QString("Way %1").arg(way);
+        if (line.block < 0) {
+            ui->textBrowser->append(QString("  %1: [EMPTY]").arg(wayName));
         } else {
-            ui->textBrowser->append(QString("  Way %1: Tag=%2, First Access=%3, Last Access=%4")
-                                        .arg(way)
-                                        .arg(cache[setIndex][way].tag)
-                                        .arg(cache[setIndex][way].firstaccess)
-                                        .arg(cache[setIndex][way].lastaccess));
-        }
-
-        if (cache[setIndex][way].tag == tagStr) {
-            hit = true;
-            hitWay = way;
+            ui->textBrowser->append(QString("  %1: Tag=%2, First Access=%3, Last Access=%4")
+                                        .arg(wayName)
+                                        .arg(engine.tagOf(line.block))
+                                        .arg(line.firstaccess)
+                                        .arg(line.lastaccess));
         }
     }
 
+    CacheEngine::AccessResult result = engine.access(byteAddress);
+    intervalStats.record(result);
+    int64_t cycles = timing.record(result);
+    setIndex = result.setIndex;   // skewed: the set of the way that was used
+    int accessTime = static_cast<int>(engine.accessCounter() - 1);
+    QString valueHex = QString("%1").arg(result.value, 2, 16, QLatin1Char('0')).toUpper();
+
     // Step 5: Hit or Miss result
     ui->textBrowser->append(QString("\n--- STEP 5: RESULT ---"));
 
-    if (hit) {
+    if (result.hit) {
         ui->textBrowser->append(QString("✓✓✓ CACHE HIT! ✓✓✓"));
         ui->textBrowser->append(QString("  - Found matching tag %1 in Set %2, Way %3")
-                                    .arg(tag).arg(setIndex).arg(hitWay));
+                                    .arg(tag).arg(setIndex).arg(result.way));
         ui->textBrowser->append(QString("  - The requested block is already in the cache!"));
         ui->textBrowser->append(QString("  - We can retrieve byte %1 directly from the cache").arg(byteAddress));
         ui->textBrowser->append(QString("  - Updating last access time from %1 to %2")
-                                    .arg(cache[setIndex][hitWay].lastaccess)
-                                    .arg(accessCounter));
-
-        cache[setIndex][hitWay].lastaccess = accessCounter;
-
-        // Show the actual byte value
-        if (byteOffset < cache[setIndex][hitWay].data.size()) {
-            uint8_t value = cache[setIndex][hitWay].data[byteOffset];
-            QString hex = QString("%1").arg(value, 2, 16, QLatin1Char('0')).toUpper();
-            ui->textBrowser->append(QString("  - Byte value at offset %1: 0x%2").arg(byteOffset).arg(hex));
-        }
+                                    .arg(before[result.way].lastaccess)
+                                    .arg(accessTime));
+        ui->textBrowser->append(QString("  - Byte value at offset %1: 0x%2").arg(byteOffset).arg(valueHex));
 
     } else {
         ui->textBrowser->append(QString("✗✗✗ CACHE MISS! ✗✗✗"));
         ui->textBrowser->append(QString("  - Tag %1 not found in Set %2").arg(tag).arg(setIndex));
         ui->textBrowser->append(QString("  - The requested block is NOT in the cache"));
-        ui->textBrowser->append(QString("  - We must fetch Block %1 from main memory").arg(blockAddress));
+        if (result.victimHit) {
+            ui->textBrowser->append(QString("  - But the victim cache still holds Block %1 (evicted earlier)").arg(blockAddress));
+            ui->textBrowser->append(QString("  - It moves back into the cache, no trip to main memory needed"));
+        } else {
+            if (engine.victimEntries() > 0)
+                ui->textBrowser->append(QString("  - The victim cache doesn't have it either"));
+            ui->textBrowser->append(QString("  - We must fetch Block %1 from main memory").arg(blockAddress));
+        }
 
         // Step 6: Determine where to place the block
         ui->textBrowser->append(QString("\n--- STEP 6: BLOCK PLACEMENT ---"));
 
-        int targetWay = -1;
+        int targetWay = result.way;
 
-        // First, check for empty line
-        for (int way = 0; way < cache[setIndex].size(); ++way) {
-            if (cache[setIndex][way].tag.isEmpty()) {
-                targetWay = way;
-                ui->textBrowser->append(QString("  - Found empty Way %1 in Set %2").arg(way).arg(setIndex));
-                ui->textBrowser->append(QString("  - No replacement needed, placing block directly"));
-                break;
-            }
-        }
-
-        // If no empty line, use replacement policy
-        if (targetWay == -1) {
-            ui->textBrowser->append(QString("  - All ways in Set %1 are occupied").arg(setIndex));
+        if (!result.evicted) {
+            ui->textBrowser->append(QString("  - Found empty Way %1 in Set %2").arg(targetWay).arg(setIndex));
+            ui->textBrowser->append(QString("  - No replacement needed, placing block directly"));
+        } else {
+            if (skewed)
+                ui->textBrowser->append("  - All candidate lines (one per way) are occupied");
+            else
+                ui->textBrowser->append(QString("  - All ways in Set %1 are occupied").arg(setIndex));
             ui->textBrowser->append(QString("  - Must evict a block using replacement policy"));
 
-            QString policyName = (currentReplacementPolicy == 5) ? "LRU (Least Recently Used)" : "FIFO (First In First Out)";
+            QString policyName = (engine.policy() == CacheEngine::LRU) ? "LRU (Least Recently Used)" : "FIFO (First In First Out)";
             ui->textBrowser->append(QString("  - Replacement policy: %1").arg(policyName));
 
-            if (currentReplacementPolicy == 5) {
-                targetWay = findReplacementWay_LRU(setIndex);
+            if (engine.policy() == CacheEngine::LRU) {
                 ui->textBrowser->append(QString("  - LRU selected Way %1 (last accessed at time %2)")
                                             .arg(targetWay)
-                                            .arg(cache[setIndex][targetWay].lastaccess));
+                                            .arg(before[targetWay].lastaccess));
             } else {
-                targetWay = findReplacementWay_FIFO(setIndex);
                 ui->textBrowser->append(QString("  - FIFO selected Way %1 (first loaded at time %2)")
                                             .arg(targetWay)
-                                            .arg(cache[setIndex][targetWay].firstaccess));
+                                            .arg(before[targetWay].firstaccess));
             }
 
             ui->textBrowser->append(QString("  - Evicting block with Tag %1 from Way %2")
-                                        .arg(cache[setIndex][targetWay].tag)
+                                        .arg(engine.tagOf(result.evictedBlock))
                                         .arg(targetWay));
+            if (engine.victimEntries() > 0)
+                ui->textBrowser->append(QString("  - The evicted Block %1 moves to the victim cache instead of being dropped")
+                                            .arg(result.evictedBlock));
         }
 
-        // Step 7: Load block from memory
-        ui->textBrowser->append(QString("\n--- STEP 7: LOADING FROM MEMORY ---"));
-        ui->textBrowser->append(QString("  - Fetching Block %1 from main memory").arg(blockAddress));
-        ui->textBrowser->append(QString("  - Loading %1 bytes into Set %2, Way %3")
-                                    .arg(currentBlockSize).arg(setIndex).arg(targetWay));
-
-        // Load the entire block from mockData
-        int blockStartByte = blockAddress * currentBlockSize;
-        cache[setIndex][targetWay].tag = tagStr;
-        cache[setIndex][targetWay].firstaccess = accessCounter;
-        cache[setIndex][targetWay].lastaccess = accessCounter;
-
-        ui->textBrowser->append(QString("  - Memory addresses being fetched: %1 to %2")
-                                    .arg(blockStartByte)
-                                    .arg(blockStartByte + currentBlockSize - 1));
+        // Step 7: Load block from memory (or take it back from the victim cache)
+        int blockStartByte = blockAddress * blockSize;
+        if (result.victimHit) {
+            ui->textBrowser->append(QString("\n--- STEP 7: LOADING FROM THE VICTIM CACHE ---"));
+            ui->textBrowser->append(QString("  - Swapping Block %1 out of the victim cache into Set %2, Way %3")
+                                        .arg(blockAddress).arg(setIndex).arg(targetWay));
+        } else {
+            ui->textBrowser->append(QString("\n--- STEP 7: LOADING FROM MEMORY ---"));
+            ui->textBrowser->append(QString("  - Fetching Block %1 from main memory").arg(blockAddress));
+            ui->textBrowser->append(QString("  - Loading %1 bytes into Set %2, Way %3")
+                                        .arg(blockSize).arg(setIndex).arg(targetWay));
+            ui->textBrowser->append(QString("  - Memory addresses being fetched: %1 to %2")
+                                        .arg(blockStartByte)
+                                        .arg(blockStartByte + blockSize - 1));
+        }
 
         QString blockData = "  - Block data (hex): ";
-
-        // Copy data from mockData (2 hex chars per byte)
-        for (int i = 0; i < currentBlockSize; ++i) {
-            int memoryByte = blockStartByte + i;
-            if (memoryByte * 2 + 1 < 2048) {  // Check bounds
-                // Each byte is represented by 2 hex characters
-                uint8_t value = 0;
-                char highNibble = mockData[memoryByte * 2];
-                char lowNibble = mockData[memoryByte * 2 + 1];
-
-                // Convert hex char to value
-                auto hexToInt = [](char c) -> uint8_t {
-                    if (c >= '0' && c <= '9') return c - '0';
-                    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
-                    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
-                    return 0;
-                };
-
-                value = (hexToInt(highNibble) << 4) | hexToInt(lowNibble);
-                cache[setIndex][targetWay].data[i] = value;
-
-                QString hex = QString("%1").arg(value, 2, 16, QLatin1Char('0')).toUpper();
-                blockData += hex + " ";
-            }
+        const uint8_t *data = engine.lineData(setIndex, targetWay);
+        for (int i = 0; i < blockSize; ++i) {
+            blockData += QString("%1").arg(data[i], 2, 16, QLatin1Char('0')).toUpper() + " ";
         }
 
         ui->textBrowser->append(blockData);
         ui->textBrowser->append(QString("  - Successfully loaded Block %1 with Tag %2").arg(blockAddress).arg(tag));
-        ui->textBrowser->append(QString("  - Set firstaccess = %1, lastaccess = %1").arg(accessCounter));
-
-        // Show the requested byte value
-        if (byteOffset < cache[setIndex][targetWay].data.size()) {
-            uint8_t value = cache[setIndex][targetWay].data[byteOffset];
-            QString hex = QString("%1").arg(value, 2, 16, QLatin1Char('0')).toUpper();
-            ui->textBrowser->append(QString("  - Requested byte at offset %1: 0x%2").arg(byteOffset).arg(hex));
-        }
-
-        hitWay = targetWay;
+        ui->textBrowser->append(QString("  - Set firstaccess = %1, lastaccess = %1").arg(accessTime));
+        ui->textBrowser->append(QString("  - Requested byte at offset %1: 0x%2").arg(byteOffset).arg(valueHex));
     }
 
-    accessCounter++;
-
     ui->textBrowser->append(QString("\n--- CACHE STATE UPDATED ---"));
-    ui->textBrowser->append(QString("Access counter incremented to %1").arg(accessCounter));
+    ui->textBrowser->append(QString("Access counter incremented to %1").arg(engine.accessCounter()));
+    ui->textBrowser->append(QString("Totals so far: %1 hits, %2 misses, %3 evictions")
+                                .arg(engine.stats().hits)
+                                .arg(engine.stats().misses)
+                                .arg(engine.stats().evictions));
+    ui->textBrowser->append(QString("Timing: this access took %1 cycles (a hit costs %2, a DRAM fill %3 to %4 more); "
+                                    "average so far %5 cycles")
+                                .arg(cycles)
+                                .arg(timing.config().hitLatency)
+                                .arg(timing.config().rowHitCycles)
+                                .arg(timing.config().rowMissCycles)
+                                .arg(timing.amat(), 0, 'f', 1));
+    if (engine.victimEntries() > 0) {
+        ui->textBrowser->append(QString("Victim cache (%1 hits so far):").arg(engine.stats().victimHits));
+        for (int entry = 0; entry < engine.victimEntries(); ++entry) {
+            const CacheEngine::VictimLine &victim = engine.victimLine(entry);
+            if (victim.block < 0)
+                ui->textBrowser->append(QString("  Entry %1: [EMPTY]").arg(entry));
+            else
+                ui->textBrowser->append(QString("  Entry %1: Block %2 (bytes %3 to %4), parked at time %5")
+                                            .arg(entry).arg(victim.block)
+                                            .arg(victim.block * blockSize)
+                                            .arg(victim.block * blockSize + blockSize - 1)
+                                            .arg(victim.lastaccess));
+        }
+    }
     ui->textBrowser->append("Updating visual representation...\n");
 
     // Redraw the cache to show updated values
     updateCacheVisualization();
 }
 
-int MainWindow::findReplacementWay_LRU(int setIndex)
-{
-    // LRU: Find the way with the smallest lastaccess value
-    // This represents the least recently used cache line
-
-    int lruWay = 0;
-    int minAccess = cache[setIndex][0].lastaccess;
-
-    for (int way = 1; way < cache[setIndex].size(); ++way) {
-        if (cache[setIndex][way].lastaccess < minAccess) {
-            minAccess = cache[setIndex][way].lastaccess;
-            lruWay = way;
-        }
-    }
-
-    return lruWay;
-}
-
 void MainWindow::updateCacheVisualization()
 {
     if (!cacheScene) return;
@@ -734,19 +873,21 @@ void MainWindow::updateCacheVisualization()
 
     // Redraw cache contents based on associativity
     int currentRow = 0;
-    for (int set = 0; set < cache.size(); ++set) {
-        for (int way = 0; way < cache[set].size(); ++way) {
+    for (int set = 0; set < engine.numSets(); ++set) {
+        for (int way = 0; way < engine.numWays(); ++way) {
+            const CacheEngine::Line &line = engine.line(set, way);
+
             // Draw TAG value
-            if (!cache[set][way].tag.isEmpty()) {
-                QGraphicsTextItem* tagText = cacheScene->addText(cache[set][way].tag);
+            if (line.block >= 0) {
+                QGraphicsTextItem* tagText = cacheScene->addText(QString::number(engine.tagOf(line.block)));
                 tagText->setScale(0.7);
                 tagText->setPos(labelWidth + 10, currentRow * cellHeight + 10);
             }
 
             // Draw data bytes
-            for (int byte = 0; byte < cache[set][way].data.size(); ++byte) {
-                uint8_t value = cache[set][way].data[byte];
-                QString hex = QString("%1").arg(value, 2, 16, QLatin1Char('0')).toUpper();
+            const uint8_t *data = engine.lineData(set, way);
+            for (int byte = 0; byte < engine.blockSize(); ++byte) {
+                QString hex = QString("%1").arg(data[byte], 2, 16, QLatin1Char('0')).toUpper();
 
                 QGraphicsTextItem* dataText = cacheScene->addText(hex);
                 dataText->setScale(0.8);
@@ -758,20 +899,204 @@ void MainWindow::updateCacheVisualization()
         }
     }
 }
-int MainWindow::findReplacementWay_FIFO(int setIndex)
+
+void MainWindow::on_saveCheckpoint_clicked()
 {
-    // FIFO: Find the way with the smallest firstaccess value
-    // This represents the oldest cache line (first in)
+    if (engine.numWays() == 0) {
+        ui->textBrowser->append("Nothing to save yet: start the simulation first.");
+        return;
+    }
+
+    QString path = QFileDialog::getSaveFileName(this, "Save Checkpoint", QString(), "Cache checkpoints (*.ckpt)");
+    if (path.isEmpty())
+        return;
 
-    int fifoWay = 0;
-    int minFirstAccess = cache[setIndex][0].firstaccess;
+    std::string error;
+    if (!engine.saveCheckpoint(path.toStdString(), &error)) {
+        ui->textBrowser->append(QString("Error: could not save checkpoint (%1)").arg(QString::fromStdString(error)));
+        return;
+    }
+    ui->textBrowser->append(QString("Checkpoint saved to %1 after %2 accesses")
+                                .arg(path).arg(engine.accessCounter()));
+}
+
+void MainWindow::on_loadCheckpoint_clicked()
+{
+    QString path = QFileDialog::getOpenFileName(this, "Load Checkpoint", QString(), "Cache checkpoints (*.ckpt)");
+    if (path.isEmpty())
+        return;
+
+    // Load into a scratch engine first so a bad file leaves the current cache alone
+    CacheEngine loaded;
+    std::string error;
+    if (!loaded.loadCheckpoint(path.toStdString(), &error)) {
+        ui->textBrowser->append(QString("Error: could not load checkpoint (%1)").arg(QString::fromStdString(error)));
+        return;
+    }
+    if (!loaded.storesData()) {
+        ui->textBrowser->append("Error: this checkpoint has no block data (it was made by cachesim-cli)");
+        return;
+    }
+    if (loaded.sectors() > 1 || loaded.tagRatio() > 1) {
+        ui->textBrowser->append("Error: this checkpoint uses sectored lines or decoupled tags, which can't be drawn here");
+        return;
+    }
+    if (ui->cachesize->findText(QString::number(loaded.cacheSize())) < 0
+        || ui->blocksize->findText(QString::number(loaded.blockSize())) < 0
+        || ui->asso->findData(loaded.associativity()) < 0
+        || ui->victimCache->findData(loaded.victimEntries()) < 0) {
+        ui->textBrowser->append(QString("Error: checkpoint cache (%1 Bytes, %2 Byte blocks, %3 victim entries) is too big to draw here")
+                                    .arg(loaded.cacheSize()).arg(loaded.blockSize()).arg(loaded.victimEntries()));
+        return;
+    }
+
+    engine = loaded;
+    engine.loadHexMemory(mockData);
+    intervalStats.clear();
+    timing.reset(engine);
+    currentInstructionLine = 0;
+    resetStepCheckpoints();
+
+    // Show the restored configuration in the controls
+    ui->cachesize->setCurrentText(QString::number(engine.cacheSize()));
+    ui->blocksize->setCurrentText(QString::number(engine.blockSize()));
+    ui->asso->setCurrentIndex(ui->asso->findData(engine.associativity()));
+    ui->replacement->setCurrentIndex(ui->replacement->findData(engine.policy()));
+    ui->indexFunction->setCurrentIndex(ui->indexFunction->findData(engine.indexFunction()));
+    ui->victimCache->setCurrentIndex(ui->victimCache->findData(engine.victimEntries()));
+
+    ui->textBrowser->append(QString("Checkpoint loaded from %1 (%2 accesses already done)")
+                                .arg(path).arg(engine.accessCounter()));
+    ui->textBrowser->append("Instructions will run from the top of the editor on the warmed-up cache.");
+
+    int associativity = (engine.associativity() == 0) ? engine.numWays() : engine.associativity();
+    drawCacheView(engine.cacheSize(), engine.blockSize(), associativity);
+    updateCacheVisualization();
+}
+
+void MainWindow::on_history_clicked()
+{
+    TimelineWindow *tw = new TimelineWindow(intervalStats, this);
+    tw->setAttribute(Qt::WA_DeleteOnClose); // auto cleanup
+    tw->show();
+}
+
+void MainWindow::on_generateWorkload_clicked()
+{
+    QStringList patterns;
+    for (int p = WorkloadGenerator::Sequential; p <= WorkloadGenerator::MatrixTile; ++p)
+        patterns << WorkloadGenerator::patternName(WorkloadGenerator::Pattern(p));
+    patterns << "Mix of all of the above";
+
+    bool ok = false;
+    QString choice = QInputDialog::getItem(this, "Generate instructions", "Access pattern:", patterns, 0, false, &ok);
+    if (!ok)
+        return;
+    int count = QInputDialog::getInt(this, "Generate instructions", "Number of instructions:", 32, 1, 1000, 1, &ok);
+    if (!ok)
+        return;
+
+    // Keep every address inside the mock RAM shown in the memory window
+    WorkloadGenerator::Config config;
+    config.base = 0;
+    config.size = 1024;
+    config.elementSize = 1;
+    config.stride = (engine.blockSize() > 1) ? engine.blockSize() * 2 : 8;
+    config.matrixDim = 16;   // 16 x 16 bytes, walked in 4 x 4 tiles
+    config.tileDim = 4;
+
+    WorkloadGenerator generator(uint64_t(QDateTime::currentMSecsSinceEpoch()));
+    int index = patterns.indexOf(choice);
+    if (index == patterns.size() - 1) {
+        for (int p = WorkloadGenerator::Sequential; p <= WorkloadGenerator::MatrixTile; ++p) {
+            config.pattern = WorkloadGenerator::Pattern(p);
+            generator.add(config);
+        }
+    } else {
+        config.pattern = WorkloadGenerator::Pattern(index);
+        generator.add(config);
+    }
+
+    ui->textEdit->setPlainText(QString::fromStdString(generator.generateText(size_t(count))));
+    currentInstructionLine = 0;
+    if (engine.numWays() != 0)
+        resetStepCheckpoints();   // the new instructions start on the cache as it is now
+    ui->textBrowser->append(QString("Generated %1 instructions (%2). Next Step starts from the first one.")
+                                .arg(count).arg(choice));
+}
+
+void MainWindow::on_pinConfiguration_clicked()
+{
+    ConfigComparison::Config config;
+    config.cacheSize = ui->cachesize->currentText().toInt();
+    config.blockSize = ui->blocksize->currentText().toInt();
+    config.associativity = ui->asso->currentData().toInt();
+    config.policy = ui->replacement->currentData().toInt();
+    config.indexFunction = ui->indexFunction->currentData().toInt();
+    config.victimEntries = ui->victimCache->currentData().toInt();
+
+    if (config.cacheSize < config.blockSize) {
+        ui->textBrowser->append(QString("Error: Cache size (%1 Bytes) must be >= Block size (%2 Bytes)")
+                                    .arg(config.cacheSize).arg(config.blockSize));
+        return;
+    }
+    if (!pinned.addConfig(config)) {
+        ui->textBrowser->append(QString("Already %1 configurations pinned; unpin some first.")
+                                    .arg(ConfigComparison::MAX_CONFIGS));
+        return;
+    }
+    ui->textBrowser->append(QString("Pinned configuration %1: %2")
+                                .arg(pinned.configCount())
+                                .arg(QString::fromStdString(ConfigComparison::describe(config))));
+}
+
+void MainWindow::on_unpinAll_clicked()
+{
+    pinned.clear();
+    ui->textBrowser->append("All pinned configurations removed.");
+}
+
+void MainWindow::on_comparePinned_clicked()
+{
+    if (pinned.configCount() < 2) {
+        ui->textBrowser->append("Pin at least 2 configurations to compare (pick the settings, then Pin configuration).");
+        return;
+    }
+
+    if (compareThread) {
+        ui->textBrowser->append("Still comparing the pinned configurations, the window opens when they are done.");
+        return;
+    }
 
-    for (int way = 1; way < cache[setIndex].size(); ++way) {
-        if (cache[setIndex][way].firstaccess < minFirstAccess) {
-            minFirstAccess = cache[setIndex][way].firstaccess;
-            fifoWay = way;
+    // The same instructions as Next Step, without the invalid lines
+    parseInstructions();
+    auto addresses = std::make_shared<std::vector<int64_t>>();
+    QVector<int> lines;
+    for (int line = 0; line < instructionAddresses.size(); ++line) {
+        if (instructionAddresses[line] >= 0) {
+            addresses->push_back(instructionAddresses[line]);
+            lines.append(line);
         }
     }
 
-    return fifoWay;
+    // Long programs take a while, so simulate off the GUI thread on a copy
+    // that pinning or unpinning in the meantime can't touch
+    auto comparison = std::make_shared<ConfigComparison>(pinned);
+    compareThread = QThread::create([comparison, addresses]() {
+        comparison->run(addresses->data(), addresses->size());
+    });
+    connect(compareThread, &QThread::finished, this, [this, comparison, lines]() {
+        compareThread->deleteLater();
+        compareThread = nullptr;
+        ui->comparePinned->setEnabled(true);
+
+        CompareWindow *cw = new CompareWindow(*comparison, lines, currentInstructionLine, this);
+        connect(this, &MainWindow::currentInstructionChanged, cw, &CompareWindow::setCurrentLine);
+        cw->setAttribute(Qt::WA_DeleteOnClose); // auto cleanup
+        cw->show();
+    });
+    ui->comparePinned->setEnabled(false);
+    ui->textBrowser->append(QString("Comparing %1 configurations on %2 instructions...")
+                                .arg(comparison->configCount()).arg(qulonglong(addresses->size())));
+    compareThread->start();
 }
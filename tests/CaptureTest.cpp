@@ -0,0 +1,32 @@
+// Traced program for the capture tests: reads a 4K array twice on the main
+// thread and once on a second one, 3072 marked reads over 64 blocks.
+
+#include "CacheTrace.h"
+
+#include <thread>
+
+namespace {
+
+alignas(64) int values[1024];
+
+int sum()
+{
+    int total = 0;
+    for (int &value : values) {
+        CACHESIM_TRACE_READ(&value);
+        total += value;
+    }
+    return total;
+}
+
+} // namespace
+
+int main()
+{
+    int total = sum();
+    // Its batch goes out when the thread ends, the main thread's one at exit
+    std::thread worker([&total] { total += sum(); });
+    worker.join();
+    total += sum();
+    return total == 0 ? 0 : 1;
+}
@@ -0,0 +1,70 @@
+// ConfigComparison::differs on hand-made streams, for what the CLI can't
+// reach. Prints each failed check and exits non-zero if there was one.
+
+#include "ConfigComparison.h"
+
+#include <cstdio>
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const char *what)
+{
+    if (!ok) {
+        std::printf("FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+// Two 16-byte lines, fully associative
+ConfigComparison::Config twoLines(int policy)
+{
+    ConfigComparison::Config config;
+    config.cacheSize = 32;
+    config.blockSize = 16;
+    config.associativity = 0;
+    config.policy = policy;
+    return config;
+}
+
+} // namespace
+
+int main()
+{
+    // Blocks 0, 1, 0, 2: both miss, miss, hit, miss, but the last miss
+    // evicts block 1 under LRU and block 0 under FIFO
+    const int64_t addresses[] = { 0, 16, 0, 32 };
+
+    ConfigComparison same;
+    same.addConfig(twoLines(CacheEngine::LRU));
+    same.addConfig(twoLines(CacheEngine::LRU));
+    same.run(addresses, 4);
+    for (size_t a = 0; a < 4; ++a)
+        check(!same.differs(a), "identical configurations never differ");
+
+    ConfigComparison policies;
+    policies.addConfig(twoLines(CacheEngine::LRU));
+    policies.addConfig(twoLines(CacheEngine::FIFO));
+    policies.run(addresses, 4);
+    check(!policies.differs(0) && !policies.differs(1) && !policies.differs(2), "LRU and FIFO agree on the first three");
+    check(policies.result(0).outcomes[3] == ConfigComparison::Miss
+              && policies.result(1).outcomes[3] == ConfigComparison::Miss, "both miss block 2");
+    check(policies.result(0).evicted[3] == 16 && policies.result(1).evicted[3] == 0, "LRU evicts 16, FIFO evicts 0");
+    check(policies.differs(3), "same outcome but different evicted block differs");
+
+    // A victim cache turns the conflict miss on block 0 into a victim hit
+    ConfigComparison::Config direct = twoLines(CacheEngine::LRU);
+    direct.associativity = 1;
+    ConfigComparison::Config withVictim = direct;
+    withVictim.victimEntries = 1;
+    const int64_t conflicts[] = { 0, 32, 0 };
+    ConfigComparison victim;
+    victim.addConfig(direct);
+    victim.addConfig(withVictim);
+    victim.run(conflicts, 3);
+    check(victim.result(1).outcomes[2] == ConfigComparison::VictimHit, "victim cache hit is recorded");
+    check(victim.differs(2), "miss and victim hit differ");
+
+    return failures ? 1 : 0;
+}